@@ -1,6 +1,13 @@
+// 统计内存申请次数，见 alloc_bench
+#define LOGSYS_ALLOC_HOOK
+#include "../logs/alloc.hpp"
 #include "../logs/mlog.h"
 #include <vector>
 #include <thread>
+#include <cstring>
+#include <algorithm>
+#include <random>
+#include <sys/resource.h>
 
 void bench(const std::string &logger_name, size_t thr_count, size_t msg_count, size_t msg_len)
 {
@@ -18,6 +25,8 @@ void bench(const std::string &logger_name, size_t thr_count, size_t msg_count, s
     std::vector<double> cost_arry(thr_count);
     // 总日志数量/线程数量 = 每个线程要输出的日志数量
     size_t msg_ptr_thr = msg_count / thr_count;
+    // 记录内存池的申请次数，稳定运行后每个线程仅在首次输出时申请内存
+    size_t malloc_count = logsys::Arena::mallocCount();
     for (int i = 0; i < thr_count; i++)
     {
         threads.emplace_back([&, i]()
@@ -55,6 +64,7 @@ void bench(const std::string &logger_name, size_t thr_count, size_t msg_count, s
     std::cout << "\t总耗时: " << max_cost << "s\n";
     std::cout << "\t每秒输出日志数量: " << msg_per_sec << " 条\n";
     std::cout << "\t每秒输出日志大小: " << size_per_sec << " KB\n";
+    std::cout << "\t内存池申请次数: " << logsys::Arena::mallocCount() - malloc_count << "\n";
 }
 
 void sync_bench()
@@ -94,9 +104,695 @@ void async_bench()
     std::cout << "\n";
 }
 
+// 对比单队列与每个NUMA节点一个队列（工作线程绑定在节点内CPU上），单节点机器上两者基本一致
+void numa_bench()
+{
+    std::vector<std::vector<int>> nodes = logsys::util::Topology::nodes();
+    std::cout << "**************************NUMA队列测试**************************" << std::endl;
+    std::cout << "NUMA节点数量: " << nodes.size() << std::endl;
+    {
+        std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::GlobalLoggerBuilder());
+        builder->buildLoggerName("numa_single");
+        builder->buildFormmatter("%m%n");
+        builder->buildLoggerType(logsys::LoggerType::LOGGER_ASYNC);
+        builder->buildSink<logsys::FileSink>("./logfile/numa_single.log");
+        builder->build();
+    }
+    {
+        std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::GlobalLoggerBuilder());
+        builder->buildLoggerName("numa_per_node");
+        builder->buildFormmatter("%m%n");
+        builder->buildLoggerType(logsys::LoggerType::LOGGER_ASYNC);
+        builder->buildAsyncPerNode();
+        builder->buildSink<logsys::FileSink>("./logfile/numa_per_node.log");
+        builder->build();
+    }
+    size_t thr_count = std::thread::hardware_concurrency();
+    thr_count = thr_count < 4 ? 4 : thr_count;
+    std::cout << "********单队列********" << std::endl;
+    bench("numa_single", thr_count, 1000000, 100);
+    std::cout << "\n";
+    std::cout << "********每节点一个队列********" << std::endl;
+    bench("numa_per_node", thr_count, 1000000, 100);
+    std::cout << "\n";
+}
+
+// 记录每条日志从输出到落地的延迟，日志内容为输出时的时间戳（纳秒）
+class LatencySink : public logsys::LogSink
+{
+public:
+    void log(const char *data, size_t len)
+    {
+        long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now().time_since_epoch())
+                            .count();
+        const char *end = data + len;
+        while (data < end)
+        {
+            char *next = nullptr;
+            long long t = strtoll(data, &next, 10);
+            if (next == data)
+                break;
+            _latency.push_back(now - t);
+            data = next + 1;
+        }
+    }
+
+    std::vector<long long> _latency;
+};
+
+static double cpuSeconds()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+// 对比异步日志器工作线程的各种等待方式：满载吞吐，低负载（每100us一条）时的落地延迟与CPU占用
+void wait_bench()
+{
+    std::cout << "**************************等待方式测试**************************" << std::endl;
+    const char *names[] = {"BLOCK", "ADAPTIVE", "BUSY_POLL", "TIMED_BATCH"};
+    logsys::WaitStrategy strategies[] = {logsys::WaitStrategy::BLOCK, logsys::WaitStrategy::ADAPTIVE,
+                                         logsys::WaitStrategy::BUSY_POLL, logsys::WaitStrategy::TIMED_BATCH};
+    for (int i = 0; i < 4; i++)
+    {
+        // 1. 满载吞吐
+        std::string name = std::string("wait_") + names[i];
+        {
+            std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::LocalLoggerBuilder());
+            builder->buildLoggerName(name);
+            builder->buildFormmatter("%m%n");
+            builder->buildLoggerType(logsys::LoggerType::LOGGER_ASYNC);
+            builder->buildWaitStrategy(strategies[i]);
+            builder->buildSink<logsys::FileSink>("./logfile/" + name + ".log");
+            logsys::Logger::ptr logger = builder->build();
+            std::string msg(99, 'A');
+            size_t count = 500000;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t j = 0; j < count; j++)
+                logger->fatal("%s", msg.c_str());
+            logger->flush();
+            std::chrono::duration<double> cost = std::chrono::steady_clock::now() - start;
+            std::cout << names[i] << ":\n\t满载每秒输出日志数量: " << (size_t)(count / cost.count()) << " 条\n";
+        }
+        // 2. 低负载延迟与CPU占用
+        auto sink = std::make_shared<LatencySink>();
+        {
+            std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::LocalLoggerBuilder());
+            builder->buildLoggerName(name);
+            builder->buildFormmatter("%m%n");
+            builder->buildLoggerType(logsys::LoggerType::LOGGER_ASYNC);
+            builder->buildWaitStrategy(strategies[i]);
+            builder->buildSink(sink);
+            logsys::Logger::ptr logger = builder->build();
+            size_t count = 5000;
+            double cpu = cpuSeconds();
+            auto start = std::chrono::steady_clock::now();
+            for (size_t j = 0; j < count; j++)
+            {
+                long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now().time_since_epoch())
+                                    .count();
+                logger->fatal("%lld", now);
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            logger->flush();
+            std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+            cpu = cpuSeconds() - cpu;
+            std::vector<long long> &lat = sink->_latency;
+            std::sort(lat.begin(), lat.end());
+            long long sum = 0;
+            for (long long l : lat)
+                sum += l;
+            std::cout << "\t低负载落地延迟: 平均 " << (lat.empty() ? 0 : sum / (long long)lat.size() / 1000)
+                      << "us, p99 " << (lat.empty() ? 0 : lat[lat.size() * 99 / 100] / 1000)
+                      << "us, CPU占用 " << (int)(cpu / wall.count() * 100) << "%\n";
+        }
+    }
+    std::cout << "\n";
+}
+
+// 同一调用位置的相同日志刷屏时，开启与关闭重复日志抑制的对比
+void dedup_bench()
+{
+    std::cout << "**************************重复日志抑制测试**************************" << std::endl;
+    for (int dedup = 0; dedup < 2; dedup++)
+    {
+        std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::LocalLoggerBuilder());
+        builder->buildLoggerName("dedup");
+        builder->buildFormmatter("[%d{%H:%M:%S}][%p][%f:%l] %m%n");
+        builder->buildLoggerType(logsys::LoggerType::LOGGER_ASYNC);
+        if (dedup)
+            builder->buildDedup();
+        builder->buildSink<logsys::FileSink>("./logfile/dedup.log");
+        logsys::Logger::ptr logger = builder->build();
+        size_t count = 1000000;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < count; i++)
+            logger->error("connect to %s:%d failed: %s", "10.0.0.1", 8080, "Connection refused");
+        logger->flush();
+        std::chrono::duration<double> cost = std::chrono::high_resolution_clock::now() - start;
+        std::cout << (dedup ? "开启抑制" : "关闭抑制") << ": 每秒输出日志数量: " << (size_t)(count / cost.count()) << " 条\n";
+    }
+    std::cout << "\n";
+}
+
+// 顺序读取全部日志内容，模拟落地方向对缓冲区的顺序读取
+class ChecksumSink : public logsys::LogSink
+{
+public:
+    ChecksumSink() : _sum(0) {}
+    void log(const char *data, size_t len)
+    {
+        for (size_t i = 0; i < len; i++)
+            _sum += (unsigned char)data[i];
+    }
+    uint64_t _sum;
+};
+
+// 进程中透明大页的大小（KB）
+static size_t anonHugeKB()
+{
+    std::ifstream ifs("/proc/self/smaps_rollup");
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        if (line.compare(0, 14, "AnonHugePages:") == 0)
+            return strtoull(line.c_str() + 14, nullptr, 10);
+    }
+    return 0;
+}
+
+static long minorFaults()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_minflt;
+}
+
+// 异步日志器缓冲区使用普通页面与大页的对比：构建耗时，得到的大页，输出期间的缺页次数与吞吐
+void buffer_bench()
+{
+    std::cout << "**************************缓冲区内存测试**************************" << std::endl;
+    const char *names[] = {"默认", "透明大页", "预留大页+锁定"};
+    logsys::PageType pages[] = {logsys::PageType::NORMAL, logsys::PageType::TRANSPARENT_HUGE, logsys::PageType::EXPLICIT_HUGE};
+    for (int i = 0; i < 3; i++)
+    {
+        auto sink = std::make_shared<ChecksumSink>();
+        size_t huge = anonHugeKB();
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::LocalLoggerBuilder());
+        builder->buildLoggerName("buffer_logger");
+        builder->buildFormmatter("%m%n");
+        builder->buildLoggerType(logsys::LoggerType::LOGGER_ASYNC);
+        if (i > 0)
+            builder->buildBufferMemory(pages[i], i == 2);
+        builder->buildSink(sink);
+        logsys::Logger::ptr logger = builder->build();
+        std::chrono::duration<double> build = std::chrono::steady_clock::now() - start;
+        huge = anonHugeKB() - huge;
+        std::string msg(199, 'A');
+        size_t count = 1000000;
+        long faults = minorFaults();
+        start = std::chrono::steady_clock::now();
+        for (size_t j = 0; j < count; j++)
+            logger->logRaw(msg.data(), msg.size());
+        logger->flush();
+        std::chrono::duration<double> cost = std::chrono::steady_clock::now() - start;
+        faults = minorFaults() - faults;
+        std::cout << names[i] << ": 构建耗时 " << build.count() * 1000 << "ms, 大页 " << huge / 1024 << "MB, 输出期间缺页 "
+                  << faults << " 次, 每秒输出日志数量: " << (size_t)(count / cost.count()) << " 条\n";
+    }
+    std::cout << "\n";
+}
+
+// 进程的常驻内存（KB）与线程数
+static void procStatus(size_t &rss_kb, size_t &threads)
+{
+    std::ifstream ifs("/proc/self/status");
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        if (line.compare(0, 6, "VmRSS:") == 0)
+            rss_kb = strtoull(line.c_str() + 6, nullptr, 10);
+        else if (line.compare(0, 8, "Threads:") == 0)
+            threads = strtoull(line.c_str() + 8, nullptr, 10);
+    }
+}
+
+// 200个异步日志器各自独占后端与共用一个后端的对比：构建耗时，线程数与常驻内存（输出后与空闲后）
+void many_bench()
+{
+    std::cout << "**************************大量日志器测试**************************" << std::endl;
+    const size_t count = 200;
+    for (int shared = 0; shared < 2; shared++)
+    {
+        size_t rss0 = 0, thr0 = 0, rss1 = 0, thr1 = 0, rss2 = 0, rss3 = 0;
+        procStatus(rss0, thr0);
+        auto sink = std::make_shared<logsys::FileSink>("./logfile/many.log");
+        std::vector<logsys::Logger::ptr> loggers;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++)
+        {
+            std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::LocalLoggerBuilder());
+            builder->buildLoggerName("module" + std::to_string(i));
+            builder->buildFormmatter("[%c][%p] %m%n");
+            builder->buildLoggerType(logsys::LoggerType::LOGGER_ASYNC);
+            if (shared)
+                builder->buildSharedBackend();
+            builder->buildSink(sink);
+            loggers.push_back(builder->build());
+        }
+        std::chrono::duration<double> build = std::chrono::steady_clock::now() - start;
+        procStatus(rss1, thr1);
+        std::string msg(99, 'A');
+        for (size_t i = 0; i < 1000000; i++)
+            loggers[i % count]->info("%s", msg.c_str());
+        for (auto &logger : loggers)
+            logger->flush();
+        procStatus(rss2, thr1);
+        // 空闲超过检查间隔后缓冲区恢复初始大小
+        std::this_thread::sleep_for(std::chrono::milliseconds(LOOPER_SHRINK_INTERVAL_MS * 3 / 2));
+        procStatus(rss3, thr1);
+        std::cout << (shared ? "共用后端" : "独占后端") << ": 构建耗时 " << build.count() * 1000 << "ms, 线程数 +" << thr1 - thr0
+                  << ", 常驻内存 构建后 +" << (rss1 - rss0) / 1024 << "MB, 输出100万条后 +" << (rss2 - rss0) / 1024
+                  << "MB, 空闲后 +" << ((long)rss3 - (long)rss0) / 1024 << "MB\n";
+    }
+    std::cout << "\n";
+}
+
+// 同步日志器输出至滚动文件，统计单次调用的耗时分布，切换文件的耗时体现在最大值中
+void roll_bench()
+{
+    std::cout << "**************************滚动文件测试**************************" << std::endl;
+    std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::LocalLoggerBuilder());
+    builder->buildLoggerName("roll_logger");
+    builder->buildFormmatter("%m%n");
+    builder->buildLoggerType(logsys::LoggerType::LOGGER_SYNC);
+    builder->buildSink<logsys::RollBySizeSink>("./logfile/roll-", 4 * 1024 * 1024, 1024);
+    logsys::Logger::ptr logger = builder->build();
+    std::string msg(99, 'A');
+    size_t count = 1000000;
+    std::vector<long long> lat(count);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++)
+    {
+        auto t = std::chrono::steady_clock::now();
+        logger->info("%s", msg.c_str());
+        lat[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t).count();
+    }
+    logger->flush();
+    std::chrono::duration<double> cost = std::chrono::steady_clock::now() - start;
+    std::sort(lat.begin(), lat.end());
+    std::cout << "每秒输出日志数量: " << (size_t)(count / cost.count()) << " 条, 共切换 "
+              << count * 100 / (4 * 1024 * 1024) << " 次\n"
+              << "单次调用耗时: p99 " << lat[count * 99 / 100] / 1000.0 << "us, p99.99 "
+              << lat[count * 9999 / 10000] / 1000.0 << "us, 最大 " << lat[count - 1] / 1000.0 << "us\n";
+    std::cout << "\n";
+}
+
+// 已格式化完毕的日志：经过格式化的 info("%s") 与 logRaw 单条/批量输出的对比
+void raw_bench()
+{
+    std::cout << "**************************原始日志接口测试**************************" << std::endl;
+    std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::GlobalLoggerBuilder());
+    builder->buildLoggerName("raw_logger");
+    builder->buildFormmatter("%m%n");
+    builder->buildLoggerType(logsys::LoggerType::LOGGER_ASYNC);
+    builder->buildSink<logsys::FileSink>("./logfile/raw.log");
+    logsys::Logger::ptr logger = builder->build();
+    std::string line = "[12:00:00][proxy][INFO] GET /api/v1/items?page=3 200 12ms " + std::string(40, 'A') + "\n";
+    size_t count = 1000000, batch = 100;
+    std::vector<logsys::RawRecord> records(batch);
+    for (auto &rec : records)
+    {
+        rec._level = logsys::LogLevel::value::INFO;
+        rec._data = line.data();
+        rec._len = line.size();
+    }
+    for (int mode = 0; mode < 3; mode++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        if (mode == 0)
+        {
+            for (size_t i = 0; i < count; i++)
+                logger->info("%.*s", (int)line.size() - 1, line.c_str());
+        }
+        else if (mode == 1)
+        {
+            for (size_t i = 0; i < count; i++)
+                logger->logRaw(line.data(), line.size());
+        }
+        else
+        {
+            for (size_t i = 0; i < count; i += batch)
+                logger->logRaw(&records[0], batch);
+        }
+        logger->flush();
+        std::chrono::duration<double> cost = std::chrono::high_resolution_clock::now() - start;
+        const char *names[] = {"info(\"%s\")", "logRaw", "logRaw批量(100条)"};
+        std::cout << names[mode] << ": 每秒输出日志数量: " << (size_t)(count / cost.count()) << " 条\n";
+    }
+    std::cout << "\n";
+}
+
+// 模拟日志参数中开销较大的 toString 调用
+std::string heavy_to_string(size_t i)
+{
+    std::stringstream ss;
+    ss << "object{id=" << i << ", name=" << std::string(64, 'A') << "}";
+    return ss.str();
+}
+
+void lazy_bench()
+{
+    std::cout << "**************************关闭等级日志测试**************************" << std::endl;
+    std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::GlobalLoggerBuilder());
+    builder->buildLoggerName("lazy_logger");
+    builder->buildLoggerLevel(logsys::LogLevel::value::WARN);
+    builder->buildSink<logsys::FileSink>("./logfile/lazy.log");
+    logsys::Logger::ptr logger = builder->build();
+
+    const size_t count = 1000000;
+    // 参数先求值再判断等级（宏延迟求值之前的行为）
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        std::string arg = heavy_to_string(i);
+        total += arg.size();
+        if (logger->shouldLog(logsys::LogLevel::value::DEBUG))
+            logger->debug("%s", arg.c_str());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::nano> eager = end - start;
+
+    // 宏先判断等级，参数不会被求值
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < count; i++)
+    {
+        logger->debug("%s", heavy_to_string(i).c_str());
+    }
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::nano> lazy = end - start;
+    std::cout << "\t关闭的DEBUG日志(参数含toString), 先求值: " << eager.count() / count
+              << "ns/条, 延迟求值: " << lazy.count() / count << "ns/条" << (total ? "" : " ") << "\n";
+    std::cout << "\n";
+}
+
+// 转义基准测试使用的输出缓冲区
+struct EscapeBuf
+{
+    char data[8 * 1024];
+    size_t size;
+    void write(const char *str, size_t len)
+    {
+        memcpy(data + size, str, len);
+        size += len;
+    }
+};
+
+// 逐字节判断并拷贝，作为对照
+void naive_escape(EscapeBuf &out, const std::string &msg)
+{
+    for (size_t i = 0; i < msg.size(); i++)
+    {
+        unsigned char c = msg[i];
+        if (c == '\\')
+        {
+            out.write("\\\\", 2);
+            continue;
+        }
+        if (c < 0x20 || c == 0x7f)
+        {
+            char tmp[8];
+            snprintf(tmp, sizeof(tmp), "\\x%02x", c);
+            out.write(tmp, 4);
+            continue;
+        }
+        out.write(&msg[i], 1);
+    }
+}
+
+template <typename Func>
+double escape_cost(const std::string &msg, size_t count, Func func)
+{
+    EscapeBuf out;
+    size_t total = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < count; i++)
+    {
+        out.size = 0;
+        func(out, msg);
+        total += out.size;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::nano> cost = end - start;
+    // 防止编译器优化掉整个循环
+    if (total == 0)
+        std::cout << "";
+    return cost.count() / count;
+}
+
+void escape_bench()
+{
+    std::cout << "**************************消息转义测试**************************" << std::endl;
+    const size_t count = 1000000;
+    std::string clean(1024, 'A');
+    std::string dirty(1024, 'A');
+    // 每64字节混入一个需要转义的控制字符
+    for (size_t i = 32; i < dirty.size(); i += 64)
+    {
+        dirty[i] = (i % 128 == 32) ? '\n' : '\x1b';
+    }
+    auto simd = [](EscapeBuf &out, const std::string &msg)
+    { logsys::util::Escape::text(out, msg.data(), msg.size()); };
+    auto naive = [](EscapeBuf &out, const std::string &msg)
+    { naive_escape(out, msg); };
+    std::cout << "\t1KB无转义消息, SIMD: " << escape_cost(clean, count, simd) << "ns/条, 逐字节: "
+              << escape_cost(clean, count, naive) << "ns/条\n";
+    std::cout << "\t1KB含转义消息, SIMD: " << escape_cost(dirty, count, simd) << "ns/条, 逐字节: "
+              << escape_cost(dirty, count, naive) << "ns/条\n";
+    std::cout << "\n";
+}
+
+// 层级日志器：调整子系统等级的开销，以及深层日志器关闭等级的判断开销
+void hier_bench()
+{
+    std::cout << "**************************层级日志器测试**************************" << std::endl;
+    const size_t count = 1000;
+    {
+        std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::GlobalLoggerBuilder());
+        builder->buildLoggerName("hier");
+        builder->buildLoggerLevel(logsys::LogLevel::value::WARN);
+        builder->buildSink<logsys::FileSink>("./logfile/hier.log");
+        builder->build();
+    }
+    std::vector<logsys::Logger::ptr> loggers;
+    for (size_t i = 0; i < count; i++)
+    {
+        std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::GlobalLoggerBuilder());
+        builder->buildLoggerName("hier.s" + std::to_string(i % 10) + ".c" + std::to_string(i));
+        loggers.push_back(builder->build());
+    }
+
+    // 逐个设置全部日志器（层级之前调整子系统等级的方式）
+    auto start = std::chrono::high_resolution_clock::now();
+    for (auto &logger : loggers)
+        logger->setLevel(logsys::LogLevel::value::ERROR);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::micro> each = end - start;
+    for (auto &logger : loggers)
+        logger->setLevel(logsys::LogLevel::value::UNKNOW);
+
+    // 只设置父日志器，子孙日志器随之更新
+    logsys::Logger::ptr parent = logsys::getLogger("hier");
+    start = std::chrono::high_resolution_clock::now();
+    parent->setLevel(logsys::LogLevel::value::ERROR);
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::micro> once = end - start;
+    std::cout << "\t" << count << "个日志器改为ERROR, 逐个设置: " << each.count() << "us, 设置父日志器: " << once.count() << "us"
+              << (loggers.back()->level() == logsys::LogLevel::value::ERROR ? "" : " (未生效)") << "\n";
+
+    // 关闭等级的判断开销与层级深度无关
+    const size_t calls = 10000000;
+    logsys::Logger::ptr leaf = loggers.back();
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < calls; i++)
+        leaf->debug("%zu", i);
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::nano> deep = end - start;
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < calls; i++)
+        parent->debug("%zu", i);
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::nano> top = end - start;
+    std::cout << "\t关闭的DEBUG日志, 三层子日志器: " << deep.count() / calls << "ns/条, 父日志器: " << top.count() / calls << "ns/条\n";
+    std::cout << "\n";
+}
+
+// 多线程取得输出管线的开销：落地方向的等级高于日志等级，每条日志只取得管线并判断掩码，不落地
+void pipeline_bench()
+{
+    std::cout << "**************************输出管线获取测试**************************" << std::endl;
+    logsys::LogSink::ptr sink = std::make_shared<logsys::FileSink>("./logfile/pipeline.log");
+    sink->setLevel(logsys::LogLevel::value::ERROR);
+    std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::GlobalLoggerBuilder());
+    builder->buildLoggerName("pipeline");
+    builder->buildSink(sink);
+    logsys::Logger::ptr logger = builder->build();
+    const size_t count = 2000000;
+    std::string line(100, 'A');
+    for (size_t thr_count : {1, 2, 4, 8})
+    {
+        std::vector<std::thread> threads;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < thr_count; i++)
+        {
+            threads.emplace_back([&]()
+                                 {
+                for (size_t j = 0; j < count; j++)
+                    logger->logRaw(line.data(), line.size()); });
+        }
+        for (auto &t : threads)
+            t.join();
+        std::chrono::duration<double, std::nano> cost = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "\t" << thr_count << "个线程, 每条: " << cost.count() / (count * thr_count) << "ns, 每秒处理日志数量: "
+                  << (size_t)(count * thr_count * 1e9 / cost.count()) << " 条\n";
+    }
+    std::cout << "\n";
+}
+
+// 突发的混合负载：各线程成批输出大小与等级各异的日志，批次之间随机停顿
+static double burst_run(logsys::Logger::ptr logger, size_t thr_count, size_t bursts)
+{
+    std::vector<std::thread> threads;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < thr_count; i++)
+    {
+        threads.emplace_back([&, i]()
+                             {
+            std::mt19937 rng(i);
+            std::lognormal_distribution<double> size(4.5, 1.0); // 中位数约90字节，少量数KB的长日志
+            std::string msg(8192, 'A');
+            for (size_t b = 0; b < bursts; b++)
+            {
+                size_t n = 1 + rng() % 200;
+                for (size_t j = 0; j < n; j++)
+                {
+                    int len = (int)std::min(8192.0, 8 + size(rng));
+                    unsigned pick = rng() % 100;
+                    if (pick < 20)
+                        logger->debug("%.*s", len, msg.c_str());
+                    else if (pick < 90)
+                        logger->info("%.*s", len, msg.c_str());
+                    else if (pick < 98)
+                        logger->warn("%.*s", len, msg.c_str());
+                    else
+                        logger->error("%.*s", len, msg.c_str());
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(rng() % 2000));
+            } });
+    }
+    for (auto &t : threads)
+        t.join();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// 负载录制：录制的开销与文件大小，录制文件可由 replay 回放
+void trace_bench()
+{
+    std::cout << "**************************负载录制测试**************************" << std::endl;
+    std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::GlobalLoggerBuilder());
+    builder->buildLoggerName("trace_logger");
+    builder->buildLoggerType(logsys::LoggerType::LOGGER_ASYNC);
+    builder->buildSink<logsys::FileSink>("./logfile/trace.log");
+    logsys::Logger::ptr logger = builder->build();
+
+    const size_t thr_count = 16, bursts = 100;
+    double plain = burst_run(logger, thr_count, bursts);
+    logsys::Trace::start("./logfile/bench.trace");
+    double traced = burst_run(logger, thr_count, bursts);
+    logsys::Trace::stop();
+    logger->flush();
+
+    logsys::TraceReader reader;
+    if (reader.load("./logfile/bench.trace") == false)
+    {
+        std::cout << "\t" << reader.lastError() << "\n";
+        return;
+    }
+    size_t records = 0;
+    for (auto &events : reader.threads())
+        records += events.size();
+    struct stat st;
+    size_t file_size = stat("./logfile/bench.trace", &st) == 0 ? st.st_size : 0;
+    std::cout << "\t" << thr_count << "个线程突发输出, 不录制: " << plain << "ms, 录制: " << traced << "ms\n";
+    std::cout << "\t录制 " << records << "条, 文件 " << file_size / 1024 << "KB, 每条 "
+              << (records ? (double)file_size / records : 0) << "字节, 回放: ./replay ./logfile/bench.trace\n";
+    std::cout << "\n";
+}
+
+// 稳定运行后输出日志不应再申请内存：预热后统计生产者线程的内存申请次数
+static size_t alloc_run(logsys::Logger::ptr logger, size_t count)
+{
+    std::string arg(64, 'A');
+    for (size_t i = 0; i < count; i++)
+        logger->info("预热 %zu %s", i, arg.c_str());
+    size_t before = logsys::util::AllocCounter::thread();
+    for (size_t i = 0; i < count; i++)
+        logger->info("测试 %zu %s", i, arg.c_str());
+    return logsys::util::AllocCounter::thread() - before;
+}
+
+void alloc_bench()
+{
+    std::cout << "**************************内存申请测试**************************" << std::endl;
+    if (logsys::util::AllocCounter::enabled() == false)
+    {
+        std::cout << "\t未启用内存申请计数（NDEBUG 构建或非 glibc）\n\n";
+        return;
+    }
+    const size_t count = 100000;
+    std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::GlobalLoggerBuilder());
+    builder->buildLoggerName("alloc_sync");
+    builder->buildSink<logsys::FileSink>("./logfile/alloc.log");
+    size_t sync_allocs = alloc_run(builder->build(), count);
+
+    builder.reset(new logsys::GlobalLoggerBuilder());
+    builder->buildLoggerName("alloc_async");
+    builder->buildLoggerType(logsys::LoggerType::LOGGER_ASYNC);
+    builder->buildSink<logsys::FileSink>("./logfile/alloc_async.log");
+    logsys::Logger::ptr async_logger = builder->build();
+    size_t async_allocs = alloc_run(async_logger, count);
+    async_logger->flush();
+
+    std::cout << "\t预热后输出" << count << "条, 生产者线程的内存申请次数, 同步: " << sync_allocs
+              << ", 异步: " << async_allocs << "\n";
+    assert(sync_allocs == 0 && async_allocs == 0);
+    std::cout << "\n";
+}
+
 int main()
 {
     sync_bench();
     async_bench();
+    numa_bench();
+    wait_bench();
+    dedup_bench();
+    raw_bench();
+    roll_bench();
+    buffer_bench();
+    many_bench();
+    lazy_bench();
+    hier_bench();
+    pipeline_bench();
+    trace_bench();
+    escape_bench();
+    alloc_bench();
+    // 输出量最多的日志语句
+    std::cout << logsys::CallSite::report(5);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,185 @@
+// 按录制文件回放日志负载：还原各线程的日志时间，等级，消息大小与调用位置，对任意日志器配置进行测试
+// 用法：replay 录制文件 [配置文件] [日志器名称] [速度]
+//   配置文件  使用其中的日志器配置，不指定或为空字符串时使用写入 ./logfile/replay.log 的同步日志器
+//   日志器名称 默认为 replay
+//   速度      1（默认）按录制时的节奏回放，2 为两倍速，0 为不等待，尽快输出
+#include "../logs/mlog.h"
+#include <vector>
+#include <thread>
+#include <cstdlib>
+#include <algorithm>
+
+#define REPLAY_SPIN_NS 100000 // 距离下一条日志不足该时间时忙等，否则睡眠
+
+// 每个回放线程的统计
+struct ReplayStat
+{
+    std::vector<uint64_t> _latency; // 每次日志调用的耗时（纳秒）
+    std::vector<uint64_t> _lag;     // 每条日志实际开始输出的时间晚于录制时间的量（纳秒）
+    size_t _bytes;
+};
+
+static uint64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t percentile(std::vector<uint64_t> &vals, double p)
+{
+    if (vals.empty())
+        return 0;
+    size_t idx = std::min(vals.size() - 1, (size_t)(vals.size() * p));
+    std::nth_element(vals.begin(), vals.begin() + idx, vals.end());
+    return vals[idx];
+}
+
+static void replayThread(logsys::Logger::ptr logger, const std::vector<logsys::TraceReader::Event> &events,
+                         std::vector<std::unique_ptr<logsys::CallSite>> &sites, const std::string &payload,
+                         uint64_t start, double speed, ReplayStat &stat)
+{
+    stat._bytes = 0;
+    stat._latency.reserve(events.size());
+    stat._lag.reserve(events.size());
+    for (auto &ev : events)
+    {
+        uint64_t due = start + (speed > 0 ? (uint64_t)(ev._time / speed) : 0);
+        uint64_t now = nowNs();
+        while (now < due)
+        {
+            if (due - now > REPLAY_SPIN_NS)
+                std::this_thread::sleep_for(std::chrono::nanoseconds(due - now - REPLAY_SPIN_NS / 2));
+            now = nowNs();
+        }
+        stat._lag.push_back(now - due);
+
+        int len = (int)std::min((size_t)ev._size, payload.size());
+        logsys::CallSite &site = *sites[ev._site];
+        // 录制时未经过格式化的日志（logRaw）同样原样输出
+        if (site.file()[0] == '\0')
+        {
+            logger->logRaw(payload.c_str(), len, ev._level);
+        }
+        else
+        {
+            // 成员函数名加括号，避免被同名的日志宏展开
+            switch (ev._level)
+            {
+            case logsys::LogLevel::value::DEBUG:
+                (logger->debug)(site, "%.*s", len, payload.c_str());
+                break;
+            case logsys::LogLevel::value::INFO:
+                (logger->info)(site, "%.*s", len, payload.c_str());
+                break;
+            case logsys::LogLevel::value::WARN:
+                (logger->warn)(site, "%.*s", len, payload.c_str());
+                break;
+            case logsys::LogLevel::value::ERROR:
+                (logger->error)(site, "%.*s", len, payload.c_str());
+                break;
+            case logsys::LogLevel::value::FATAL:
+                (logger->fatal)(site, "%.*s", len, payload.c_str());
+                break;
+            default:
+                break;
+            }
+        }
+        stat._latency.push_back(nowNs() - now);
+        stat._bytes += len;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "用法: " << argv[0] << " 录制文件 [配置文件] [日志器名称] [速度]\n";
+        return 1;
+    }
+    // 1. 读取录制文件
+    logsys::TraceReader reader;
+    if (reader.load(argv[1]) == false)
+    {
+        std::cout << reader.lastError() << "\n";
+        return 1;
+    }
+    std::string name = argc > 3 ? argv[3] : "replay";
+    double speed = argc > 4 ? atof(argv[4]) : 1.0;
+
+    // 2. 准备日志器：使用配置文件中的日志器，没有时创建默认的同步日志器
+    std::unique_ptr<logsys::Config> config;
+    if (argc > 2 && argv[2][0] != '\0')
+    {
+        config.reset(new logsys::Config(argv[2]));
+        if (config->load() == false)
+        {
+            std::cout << config->lastError() << "\n";
+            return 1;
+        }
+    }
+    logsys::Logger::ptr logger = logsys::getLogger(name);
+    if (logger.get() == nullptr)
+    {
+        std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::GlobalLoggerBuilder());
+        builder->buildLoggerName(name);
+        builder->buildFormmatter("%m%n");
+        builder->buildSink<logsys::FileSink>("./logfile/replay.log");
+        logger = builder->build();
+    }
+
+    // 3. 还原调用位置，统计录制的负载
+    std::vector<std::unique_ptr<logsys::CallSite>> sites;
+    for (auto &s : reader.sites())
+        sites.emplace_back(new logsys::CallSite(s._file.c_str(), s._line, logsys::LogLevel::value::UNKNOW));
+    size_t records = 0, bytes = 0, max_size = 0;
+    uint64_t duration = 0;
+    for (auto &events : reader.threads())
+    {
+        records += events.size();
+        for (auto &ev : events)
+        {
+            bytes += ev._size;
+            max_size = std::max(max_size, (size_t)ev._size);
+            if (ev._site >= sites.size())
+            {
+                std::cout << "调用位置编号超出范围: " << ev._site << "\n";
+                return 1;
+            }
+        }
+        if (events.empty() == false)
+            duration = std::max(duration, events.back()._time);
+    }
+    std::cout << "录制负载: " << reader.threads().size() << "个线程, " << records << "条, " << bytes / 1024 << "KB, "
+              << sites.size() << "个调用位置, 时长 " << duration / 1000000.0 << "ms\n";
+
+    // 4. 每个录制线程一个回放线程，按录制时间输出
+    std::string payload(max_size, 'A');
+    std::vector<ReplayStat> stats(reader.threads().size());
+    std::vector<std::thread> threads;
+    uint64_t start = nowNs() + 10000000; // 留出创建线程的时间
+    for (size_t i = 0; i < reader.threads().size(); i++)
+        threads.emplace_back(replayThread, logger, std::cref(reader.threads()[i]), std::ref(sites), std::cref(payload),
+                             start, speed, std::ref(stats[i]));
+    for (auto &t : threads)
+        t.join();
+    uint64_t produced = nowNs();
+    logger->flush();
+    uint64_t flushed = nowNs();
+
+    // 5. 汇总
+    std::vector<uint64_t> latency, lag;
+    size_t out_bytes = 0;
+    for (auto &st : stats)
+    {
+        latency.insert(latency.end(), st._latency.begin(), st._latency.end());
+        lag.insert(lag.end(), st._lag.begin(), st._lag.end());
+        out_bytes += st._bytes;
+    }
+    double wall = (flushed - start) / 1e9;
+    std::cout << "回放(速度 " << speed << "): 生产耗时 " << (produced - start) / 1e6 << "ms, 含刷新 " << wall * 1e3 << "ms, "
+              << (size_t)(records / wall) << "条/s, " << (size_t)(out_bytes / wall / 1024) << "KB/s\n";
+    std::cout << "\t调用耗时 p50: " << percentile(latency, 0.5) << "ns, p99: " << percentile(latency, 0.99)
+              << "ns, p99.9: " << percentile(latency, 0.999) << "ns, 最大: " << percentile(latency, 1.0) << "ns\n";
+    if (speed > 0)
+        std::cout << "\t落后录制节奏 p99: " << percentile(lag, 0.99) / 1000 << "us, 最大: " << percentile(lag, 1.0) / 1000 << "us\n";
+    return 0;
+}
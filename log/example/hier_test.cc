@@ -0,0 +1,114 @@
+// 层级日志器多线程测试：子日志器继承父日志器的落地方向，多个线程同时向父子日志器输出，
+// 检查共用的文件与按大小切换的文件中每行日志完整，条数不多不少（同步与异步日志器各测一次）
+#include "../logs/mlog.h"
+#include <cassert>
+#include <fstream>
+#include <set>
+#include <thread>
+#include <dirent.h>
+
+#define HIER_TEST_DIR "./logfile/hier_test/"
+#define HIER_TEST_THREADS 4
+#define HIER_TEST_COUNT 5000
+
+static std::vector<std::string> listFiles()
+{
+    std::vector<std::string> files;
+    DIR *dir = opendir(HIER_TEST_DIR);
+    if (dir == nullptr)
+        return files;
+    while (dirent *ent = readdir(dir))
+    {
+        if (ent->d_name[0] != '.')
+            files.push_back(std::string(HIER_TEST_DIR) + ent->d_name);
+    }
+    closedir(dir);
+    return files;
+}
+
+// 检查文件中的每一行，返回行数，行内容记入 seen
+static size_t checkFile(const std::string &path, const std::string &payload, std::set<std::string> &seen)
+{
+    std::ifstream in(path);
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(in, line))
+    {
+        // 格式：日志器名称 线程 序号 负载
+        size_t sp = line.rfind(' ');
+        assert(sp != std::string::npos && line.compare(sp + 1, std::string::npos, payload) == 0);
+        seen.insert(line.substr(0, sp));
+        lines++;
+    }
+    return lines;
+}
+
+static void testHierarchy(const std::string &name, logsys::LoggerType type)
+{
+    for (auto &file : listFiles())
+        unlink(file.c_str());
+    {
+        std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::GlobalLoggerBuilder());
+        builder->buildLoggerName(name);
+        builder->buildLoggerType(type);
+        builder->buildFormmatter("%c %m%n");
+        builder->buildSink<logsys::FileSink>(HIER_TEST_DIR "file.log");
+        builder->buildSink<logsys::RollBySizeSink>(HIER_TEST_DIR "roll-", 64 * 1024);
+        builder->build();
+    }
+    {
+        // 不设置格式化器与落地方向，继承父日志器的
+        std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::GlobalLoggerBuilder());
+        builder->buildLoggerName(name + ".child");
+        builder->buildLoggerType(type);
+        builder->build();
+    }
+    logsys::Logger::ptr parent = logsys::getLogger(name);
+    logsys::Logger::ptr child = logsys::getLogger(name + ".child");
+
+    std::string payload(64, 'A');
+    std::vector<std::thread> threads;
+    for (int t = 0; t < HIER_TEST_THREADS * 2; t++)
+    {
+        logsys::Logger::ptr logger = t % 2 ? child : parent;
+        threads.emplace_back([logger, t, &payload]()
+                             {
+            for (int i = 0; i < HIER_TEST_COUNT; i++)
+                logger->info("%d %d %s", t, i, payload.c_str()); });
+    }
+    for (auto &t : threads)
+        t.join();
+    parent->flush();
+    child->flush();
+
+    // 两个落地方向各收到全部日志
+    const size_t total = HIER_TEST_THREADS * 2 * HIER_TEST_COUNT;
+    std::set<std::string> file_seen, roll_seen;
+    size_t file_lines = 0, roll_lines = 0, roll_files = 0;
+    for (auto &file : listFiles())
+    {
+        if (file == HIER_TEST_DIR "file.log")
+        {
+            file_lines += checkFile(file, payload, file_seen);
+        }
+        else
+        {
+            roll_lines += checkFile(file, payload, roll_seen);
+            roll_files++;
+        }
+    }
+    assert(file_lines == total && file_seen.size() == total);
+    assert(roll_lines == total && roll_seen.size() == total);
+    std::cout << name << ": " << HIER_TEST_THREADS * 2 << " 个线程, 每个落地方向 " << total << " 行, 切换文件 "
+              << roll_files << " 个\n";
+    logsys::LoggerManager::getInstance().removeLogger(name + ".child");
+    logsys::LoggerManager::getInstance().removeLogger(name);
+}
+
+int main()
+{
+    testHierarchy("hier_sync", logsys::LoggerType::LOGGER_SYNC);
+    testHierarchy("hier_async", logsys::LoggerType::LOGGER_ASYNC);
+    std::cout << "全部通过\n";
+    return 0;
+}
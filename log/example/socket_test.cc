@@ -0,0 +1,295 @@
+// 套接字落地方向测试：在本机建立 UDP，Unix域数据报与Unix域字节流的监听端，检查每条日志的分隔与条数，
+// 字节流在日志只发送了一部分时关闭监听端，再重新监听，检查重连后日志完整，没有丢失
+#include "../logs/mlog.h"
+#include <cassert>
+#include <set>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define UNIX_DGRAM_PATH "/tmp/logsys_socket_test_dgram.sock"
+#define UNIX_STREAM_PATH "/tmp/logsys_socket_test_stream.sock"
+
+static logsys::Logger::ptr makeLogger(const std::string &name, const logsys::LogSink::ptr &sink,
+                                      logsys::LoggerType type = logsys::LoggerType::LOGGER_SYNC)
+{
+    std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::LocalLoggerBuilder());
+    builder->buildLoggerName(name);
+    builder->buildLoggerType(type);
+    builder->buildFormmatter("%m%n");
+    builder->buildSink(sink);
+    return builder->build();
+}
+
+// 接收超时，丢失数据时断言失败而不是一直等待
+static void setTimeout(int fd)
+{
+    timeval tv = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+static int bindSocket(const logsys::SockAddr &addr, int type)
+{
+    int fd = socket(addr._family, type | SOCK_CLOEXEC, 0);
+    assert(fd >= 0);
+    if (addr._family == AF_UNIX)
+        unlink(((const sockaddr_un *)&addr._addr)->sun_path);
+    int ret = bind(fd, (const sockaddr *)&addr._addr, addr._len);
+    assert(ret == 0);
+    (void)ret;
+    setTimeout(fd);
+    return fd;
+}
+
+// RFC5424：不符合 PARAM-NAME 要求的键名被替换与截断，结构化数据仍可正确解析
+static void testSyslog(const logsys::LogSink::ptr &sink, int fd)
+{
+    std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::LocalLoggerBuilder());
+    builder->buildLoggerName("syslog");
+    builder->buildFormmatter<logsys::SyslogFormatter>("socket_test");
+    builder->buildSink(sink);
+    logsys::Logger::ptr logger = builder->build();
+    std::string long_key(40, 'k');
+    {
+        logsys::MDC::Scope scope("req id", "a\"b]");
+        logsys::Fields fields{{"a=b", 1}, {"x]\"y", 2}, {"", 3}, {long_key.c_str(), 4}};
+        logger->info(fields, "hello");
+    }
+    char buf[4096];
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    assert(n > 0);
+    std::string dgram(buf, n);
+    std::string expect = "[fields@32473 a_b=\"1\" x__y=\"2\" _=\"3\" " + std::string(32, 'k') +
+                         "=\"4\" req_id=\"a\\\"b\\]\"] hello";
+    assert(dgram.find(expect) != std::string::npos);
+    std::cout << "syslog: " << dgram << "\n";
+}
+
+// 数据报：每条日志一个数据报，内容为去掉换行的日志
+static void testDgram(const std::string &name, const logsys::LogSink::ptr &sink, int fd)
+{
+    const int count = 1000;
+    logsys::Logger::ptr logger = makeLogger(name, sink);
+    std::string pad(100, 'x');
+    char buf[4096];
+    int received = 0;
+    // 每发送一批后收完，避免接收队列溢出（Unix域数据报默认最多排队 10 个，见 net.unix.max_dgram_qlen）
+    for (int i = 0; i < count; i++)
+    {
+        logger->info("rec %d %s", i, pad.c_str());
+        if (i % 8 != 7)
+            continue;
+        while (received <= i)
+        {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            assert(n > 0);
+            std::string expect = "rec " + std::to_string(received) + " " + pad;
+            assert(std::string(buf, n) == expect);
+            received++;
+        }
+    }
+    logsys::SinkStats st = std::static_pointer_cast<logsys::SocketSink>(sink)->stats();
+    assert(received == count && st._records == (uint64_t)count && st._dropped == 0);
+    std::cout << name << ": " << received << " 个数据报, 发送调用 " << st._batches << " 次\n";
+}
+
+// 读取字节流中已到达的数据，拆分为行；last 保存不完整的行
+static void readLines(int fd, std::string &last, std::vector<std::string> &lines, bool wait)
+{
+    char buf[65536];
+    while (true)
+    {
+        ssize_t n = recv(fd, buf, sizeof(buf), wait ? 0 : MSG_DONTWAIT);
+        if (n <= 0)
+            return;
+        last.append(buf, n);
+        size_t pos;
+        while ((pos = last.find('\n')) != std::string::npos)
+        {
+            lines.push_back(last.substr(0, pos));
+            last.erase(0, pos + 1);
+        }
+        wait = false;
+    }
+}
+
+static int acceptOne(int listen_fd)
+{
+    int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    assert(fd >= 0);
+    setTimeout(fd);
+    return fd;
+}
+
+static void testStream()
+{
+    logsys::SockAddr addr = logsys::SockAddr::local(UNIX_STREAM_PATH);
+    int listen_fd = bindSocket(addr, SOCK_STREAM);
+    int ret = listen(listen_fd, 4);
+    assert(ret == 0);
+    logsys::LogSink::ptr sink = std::make_shared<logsys::UnixStreamSink>(UNIX_STREAM_PATH);
+    logsys::Logger::ptr logger = makeLogger("unix_stream", sink);
+    std::shared_ptr<logsys::StreamSink> stream = std::static_pointer_cast<logsys::StreamSink>(sink);
+
+    // 1. 正常发送：逐行完整，顺序一致；连接被接受前对端排队的数据有限，其余的日志积压，刷新时发送
+    const int first = 1000;
+    for (int i = 0; i < first; i++)
+        logger->info("rec %d", i);
+    int conn = acceptOne(listen_fd);
+    std::string last;
+    std::vector<std::string> lines;
+    for (int round = 0; round < 1000 && (int)lines.size() < first; round++)
+    {
+        sink->flush();
+        readLines(conn, last, lines, true);
+    }
+    assert((int)lines.size() == first);
+    for (int i = 0; i < first; i++)
+        assert(lines[i] == "rec " + std::to_string(i));
+
+    // 2. 对端不读取，写满套接字缓冲区，使部分日志只发送了一部分
+    std::string big(4000, 'y');
+    const int total = first + 200;
+    for (int i = first; i < total; i++)
+        logger->info("rec %d %s", i, big.c_str());
+    assert(stream->stats()._records < (uint64_t)(total));
+
+    // 3. 读出已到达的数据后关闭监听端与连接，此时可能有一条只收到了一部分
+    readLines(conn, last, lines, false);
+    close(conn);
+    close(listen_fd);
+    unlink(UNIX_STREAM_PATH);
+    std::cout << "unix_stream: 关闭监听端前收到 " << lines.size() << " 行, 最后不完整的数据 " << last.size() << " 字节\n";
+    size_t old_lines = lines.size();
+    last.clear();
+
+    // 4. 监听端关闭期间继续输出，发送失败后按退避重连，日志保留在积压缓冲区中
+    const int down = 20;
+    for (int i = total; i < total + down; i++)
+    {
+        logger->info("rec %d", i);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    // 5. 重新监听，定期刷新触发重连，收到全部日志为止
+    listen_fd = bindSocket(addr, SOCK_STREAM);
+    ret = listen(listen_fd, 4);
+    assert(ret == 0);
+    std::vector<std::string> resent;
+    conn = -1;
+    const int all = total + down;
+    for (int round = 0; round < 1000; round++)
+    {
+        sink->flush();
+        if (conn < 0)
+        {
+            pollfd pfd = {listen_fd, POLLIN, 0};
+            if (poll(&pfd, 1, 10) == 1)
+                conn = acceptOne(listen_fd);
+            continue;
+        }
+        readLines(conn, last, resent, false);
+        if (stream->stats()._records == (uint64_t)all && (int)(old_lines + resent.size()) >= all)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(conn >= 0);
+    readLines(conn, last, resent, false);
+
+    // 新连接上的每一行都是完整的日志，旧连接与新连接合起来包含每条日志
+    assert(last.empty());
+    std::set<int> seen;
+    for (size_t i = 0; i < old_lines; i++)
+        seen.insert(atoi(lines[i].c_str() + 4));
+    for (auto &line : resent)
+    {
+        assert(line.compare(0, 4, "rec ") == 0);
+        int id = atoi(line.c_str() + 4);
+        std::string expect = "rec " + std::to_string(id);
+        if (id >= first && id < total)
+            expect += " " + big;
+        assert(line == expect);
+        seen.insert(id);
+    }
+    assert((int)seen.size() == all && *seen.begin() == 0 && *seen.rbegin() == all - 1);
+    logsys::SinkStats st = stream->stats();
+    assert(st._records == (uint64_t)all && st._dropped == 0);
+    std::cout << "unix_stream: 重连后收到 " << resent.size() << " 行, 共 " << seen.size() << " 条日志, 发送调用 " << st._batches << " 次\n";
+    close(conn);
+    close(listen_fd);
+    unlink(UNIX_STREAM_PATH);
+}
+
+// 异步日志器整批输出：积压与丢弃按条计算，积压缓冲区只能容纳前 kept 条
+static void testStreamBatch()
+{
+    unlink(UNIX_STREAM_PATH); // 监听端不存在，日志全部积压
+    const int count = 500, kept = 100;
+    const size_t record_len = 16; // "rec 00000 abcde\n"
+    logsys::LogSink::ptr sink = std::make_shared<logsys::UnixStreamSink>(UNIX_STREAM_PATH, kept * record_len);
+    std::shared_ptr<logsys::StreamSink> stream = std::static_pointer_cast<logsys::StreamSink>(sink);
+    logsys::Logger::ptr logger = makeLogger("unix_stream_batch", sink, logsys::LoggerType::LOGGER_ASYNC);
+    for (int i = 0; i < count; i++)
+        logger->info("rec %05d abcde", i);
+    logger->flush();
+    logsys::SinkStats st = stream->stats();
+    assert(st._records == 0 && st._dropped == (uint64_t)(count - kept));
+
+    logsys::SockAddr addr = logsys::SockAddr::local(UNIX_STREAM_PATH);
+    int listen_fd = bindSocket(addr, SOCK_STREAM);
+    int ret = listen(listen_fd, 4);
+    assert(ret == 0);
+    (void)ret;
+    int conn = -1;
+    std::string last;
+    std::vector<std::string> lines;
+    for (int round = 0; round < 1000 && (int)lines.size() < kept; round++)
+    {
+        logger->flush();
+        if (conn < 0)
+        {
+            pollfd pfd = {listen_fd, POLLIN, 0};
+            if (poll(&pfd, 1, 10) == 1)
+                conn = acceptOne(listen_fd);
+            continue;
+        }
+        readLines(conn, last, lines, false);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert((int)lines.size() == kept && last.empty());
+    char expect[32];
+    for (int i = 0; i < kept; i++)
+    {
+        snprintf(expect, sizeof(expect), "rec %05d abcde", i);
+        assert(lines[i] == expect);
+    }
+    st = stream->stats();
+    assert(st._records == (uint64_t)kept && st._dropped == (uint64_t)(count - kept));
+    std::cout << "unix_stream_batch: 积压 " << lines.size() << " 条, 丢弃 " << st._dropped << " 条\n";
+    close(conn);
+    close(listen_fd);
+    unlink(UNIX_STREAM_PATH);
+}
+
+int main()
+{
+    logsys::SockAddr udp = logsys::SockAddr::inet("127.0.0.1", 0);
+    int udp_fd = bindSocket(udp, SOCK_DGRAM);
+    socklen_t len = udp._len;
+    getsockname(udp_fd, (sockaddr *)&udp._addr, &len);
+    uint16_t port = ntohs(((sockaddr_in *)&udp._addr)->sin_port);
+    testDgram("udp", std::make_shared<logsys::UdpSink>("127.0.0.1", port), udp_fd);
+    testSyslog(std::make_shared<logsys::UdpSink>("127.0.0.1", port), udp_fd);
+    close(udp_fd);
+
+    logsys::SockAddr dgram = logsys::SockAddr::local(UNIX_DGRAM_PATH);
+    int dgram_fd = bindSocket(dgram, SOCK_DGRAM);
+    testDgram("unix_dgram", std::make_shared<logsys::UnixDgramSink>(UNIX_DGRAM_PATH), dgram_fd);
+    close(dgram_fd);
+    unlink(UNIX_DGRAM_PATH);
+
+    testStream();
+    testStreamBatch();
+    std::cout << "全部通过\n";
+    return 0;
+}
@@ -24,6 +24,7 @@ int main()
     builder->buildSink<logsys::RollBySizeSink>("./logfile/roll-sync-by-size", 1024 * 1024);
     builder->build();
     test_log("async_logger");
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    // 等待日志全部落地
+    logsys::LoggerManager::getInstance().flushAll();
     return 0;
 }
\ No newline at end of file
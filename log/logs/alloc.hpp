@@ -0,0 +1,119 @@
+/*
+    内存申请计数（调试用）：
+    1. 在程序的一个源文件中先定义 LOGSYS_ALLOC_HOOK 再包含本头文件，替换 malloc/calloc/realloc 等函数，
+       统计全部线程与当前线程调用的次数，operator new 经由 malloc 申请内存，同样被统计
+    2. 用于验证稳定运行后输出日志不再申请内存（见 bench 中的 alloc_bench）
+    3. 仅在未定义 NDEBUG 且使用 glibc 时生效，其余情况下 AllocCounter::enabled() 返回false，计数始终为0
+*/
+#ifndef __M_ALLOC_H__
+#define __M_ALLOC_H__
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+
+#if defined(LOGSYS_ALLOC_HOOK) && !defined(NDEBUG) && defined(__GLIBC__)
+#define LOGSYS_ALLOC_HOOK_ENABLED 1
+#endif
+
+namespace logsys
+{
+    namespace util
+    {
+        class AllocCounter
+        {
+        public:
+            static bool enabled()
+            {
+#if defined(LOGSYS_ALLOC_HOOK_ENABLED)
+                return true;
+#else
+                return false;
+#endif
+            }
+
+            // 全部线程累计的申请次数
+            static size_t total()
+            {
+                return totalCounter().load(std::memory_order_relaxed);
+            }
+
+            // 当前线程累计的申请次数
+            static size_t thread()
+            {
+                return threadCounter();
+            }
+
+            static void count()
+            {
+                totalCounter().fetch_add(1, std::memory_order_relaxed);
+                threadCounter()++;
+            }
+
+        private:
+            static std::atomic<size_t> &totalCounter()
+            {
+                static std::atomic<size_t> count(0);
+                return count;
+            }
+
+            // 零初始化的线程局部变量，不需要动态初始化，可在 malloc 中安全使用
+            static size_t &threadCounter()
+            {
+                static __thread size_t count;
+                return count;
+            }
+        };
+    }
+}
+
+#if defined(LOGSYS_ALLOC_HOOK_ENABLED)
+// 与 glibc 中的声明保持相同的异常说明 __THROW
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t n, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+    void *__libc_memalign(size_t align, size_t size);
+
+    void *malloc(size_t size) __THROW
+    {
+        logsys::util::AllocCounter::count();
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t n, size_t size) __THROW
+    {
+        logsys::util::AllocCounter::count();
+        return __libc_calloc(n, size);
+    }
+
+    void *realloc(void *ptr, size_t size) __THROW
+    {
+        logsys::util::AllocCounter::count();
+        return __libc_realloc(ptr, size);
+    }
+
+    void *memalign(size_t align, size_t size) __THROW
+    {
+        logsys::util::AllocCounter::count();
+        return __libc_memalign(align, size);
+    }
+
+    void *aligned_alloc(size_t align, size_t size) __THROW
+    {
+        logsys::util::AllocCounter::count();
+        return __libc_memalign(align, size);
+    }
+
+    int posix_memalign(void **ptr, size_t align, size_t size) __THROW
+    {
+        logsys::util::AllocCounter::count();
+        *ptr = __libc_memalign(align, size);
+        return *ptr == nullptr ? ENOMEM : 0;
+    }
+}
+#endif
+
+#endif
@@ -0,0 +1,294 @@
+/*
+    线程局部的日志记录内存池：
+    1. 按序（bump）分配，一条日志处理完毕后整体回退，内存块保留复用
+    2. 日志消息的消息主体以及格式化结果从内存池中分配，文件名与日志器名只记录指针
+    3. 稳定运行后不再向系统申请内存，mallocCount() 用于观察内存池的申请次数，进程全部的内存申请次数见 alloc.hpp
+*/
+#ifndef __M_ARENA_H__
+#define __M_ARENA_H__
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+namespace logsys
+{
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_STREAM_INIT_SIZE 256
+
+    // 指向外部内存的字符串片段，不持有内存
+    struct StrRef
+    {
+        const char *_data;
+        size_t _size;
+
+        StrRef() : _data(""), _size(0) {}
+        StrRef(const char *data, size_t size) : _data(data), _size(size) {}
+        const char *data() const { return _data; }
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+    };
+
+    inline std::ostream &operator<<(std::ostream &out, const StrRef &str)
+    {
+        return out.write(str._data, str._size);
+    }
+
+    class Arena
+    {
+    public:
+        // 内存池的位置标记，用于回退
+        struct Mark
+        {
+            size_t _block;
+            size_t _offset;
+        };
+
+        // RAII方式记录当前位置，作用域结束时回退，支持嵌套使用
+        class Scope
+        {
+        public:
+            Scope() : _arena(Arena::local()), _mark(_arena.mark()) {}
+            ~Scope() { _arena.rewind(_mark); }
+            Arena &arena() { return _arena; }
+
+        private:
+            Arena &_arena;
+            Mark _mark;
+        };
+
+        Arena() : _cur(0), _offset(0)
+        {
+            _blocks.reserve(8);
+            countMalloc();
+        }
+
+        ~Arena()
+        {
+            for (auto &block : _blocks)
+            {
+                free(block._data);
+            }
+        }
+
+        static Arena &local()
+        {
+            static thread_local Arena arena;
+            return arena;
+        }
+
+        char *alloc(size_t len)
+        {
+            if (_blocks.empty() || _offset + len > _blocks[_cur]._size)
+                nextBlock(len);
+            char *ptr = _blocks[_cur]._data + _offset;
+            _offset += len;
+            return ptr;
+        }
+
+        // 拷贝字符串至内存池，末尾补 '\0'
+        StrRef copy(const char *data, size_t len)
+        {
+            char *ptr = alloc(len + 1);
+            memcpy(ptr, data, len);
+            ptr[len] = '\0';
+            return StrRef(ptr, len);
+        }
+
+        // 直接在内存池中完成格式化，当前块空间不足时再申请足够大小重新格式化
+        bool vprintf(StrRef &res, const char *fmt, va_list ap)
+        {
+            if (_blocks.empty())
+                nextBlock(0);
+            va_list cp;
+            va_copy(cp, ap);
+            size_t avail = _blocks[_cur]._size - _offset;
+            char *ptr = _blocks[_cur]._data + _offset;
+            int ret = vsnprintf(ptr, avail, fmt, ap);
+            if (ret >= 0 && (size_t)ret < avail)
+            {
+                _offset += ret + 1;
+            }
+            else if (ret >= 0)
+            {
+                ptr = alloc(ret + 1);
+                vsnprintf(ptr, ret + 1, fmt, cp);
+            }
+            va_end(cp);
+            if (ret < 0)
+                return false;
+            res = StrRef(ptr, ret);
+            return true;
+        }
+
+        Mark mark() const
+        {
+            Mark m = {_cur, _offset};
+            return m;
+        }
+
+        void rewind(const Mark &m)
+        {
+            _cur = m._block;
+            _offset = m._offset;
+        }
+
+        // 所有线程的内存池累计向系统申请内存的次数
+        static size_t mallocCount()
+        {
+            return counter().load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Block
+        {
+            char *_data;
+            size_t _size;
+        };
+
+        static std::atomic<size_t> &counter()
+        {
+            static std::atomic<size_t> count(0);
+            return count;
+        }
+
+        static void countMalloc()
+        {
+            counter().fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // 切换至下一个内存块，优先复用之前申请过的块
+        void nextBlock(size_t len)
+        {
+            size_t next = _blocks.empty() ? 0 : _cur + 1;
+            size_t size = len > ARENA_BLOCK_SIZE ? len : ARENA_BLOCK_SIZE;
+            if (next < _blocks.size())
+            {
+                if (_blocks[next]._size < len)
+                {
+                    free(_blocks[next]._data);
+                    _blocks[next]._data = (char *)malloc(size);
+                    _blocks[next]._size = size;
+                    countMalloc();
+                }
+            }
+            else
+            {
+                if (_blocks.size() == _blocks.capacity())
+                    countMalloc();
+                Block block = {(char *)malloc(size), size};
+                _blocks.push_back(block);
+                countMalloc();
+            }
+            _cur = next;
+            _offset = 0;
+        }
+
+    private:
+        std::vector<Block> _blocks;
+        size_t _cur;    // 当前使用的内存块
+        size_t _offset; // 当前内存块中的分配位置
+    };
+
+    // 以内存池为存储的输出流，格式化结果随内存池一并回退
+    class ArenaStream : public std::ostream
+    {
+    public:
+        // 获取当前线程的输出流，嵌套使用（如落地过程中再次输出日志）时退化为临时对象
+        class Holder
+        {
+        public:
+            Holder(Arena &arena) : _stream(&ArenaStream::local())
+            {
+                if (_stream->_busy)
+                {
+                    _nested.reset(new ArenaStream());
+                    _stream = _nested.get();
+                }
+                _stream->start(arena);
+            }
+            ~Holder() { _stream->_busy = false; }
+            ArenaStream &operator*() { return *_stream; }
+            ArenaStream *operator->() { return _stream; }
+
+        private:
+            ArenaStream *_stream;
+            std::unique_ptr<ArenaStream> _nested;
+        };
+
+        ArenaStream() : std::ostream(&_buf), _busy(false) {}
+
+        static ArenaStream &local()
+        {
+            static thread_local ArenaStream stream;
+            return stream;
+        }
+
+        const char *data() const { return _buf.data(); }
+        size_t size() const { return _buf.size(); }
+
+    private:
+        void start(Arena &arena)
+        {
+            _busy = true;
+            _buf.start(arena);
+            clear();
+        }
+
+        class StreamBuf : public std::streambuf
+        {
+        public:
+            StreamBuf() : _arena(nullptr) {}
+            void start(Arena &arena)
+            {
+                _arena = &arena;
+                char *ptr = arena.alloc(ARENA_STREAM_INIT_SIZE);
+                setp(ptr, ptr + ARENA_STREAM_INIT_SIZE);
+            }
+            const char *data() const { return pbase(); }
+            size_t size() const { return pptr() - pbase(); }
+
+        protected:
+            // 空间不足时从内存池申请两倍空间并搬移已写入的数据
+            int_type overflow(int_type c) override
+            {
+                size_t used = size();
+                size_t cap = (epptr() - pbase()) * 2;
+                char *ptr = _arena->alloc(cap);
+                memcpy(ptr, pbase(), used);
+                setp(ptr, ptr + cap);
+                pbump((int)used);
+                if (!traits_type::eq_int_type(c, traits_type::eof()))
+                {
+                    *pptr() = traits_type::to_char_type(c);
+                    pbump(1);
+                }
+                return traits_type::not_eof(c);
+            }
+
+            std::streamsize xsputn(const char *s, std::streamsize n) override
+            {
+                while (epptr() - pptr() < n)
+                    overflow(traits_type::eof());
+                memcpy(pptr(), s, n);
+                pbump((int)n);
+                return n;
+            }
+
+        private:
+            Arena *_arena;
+        };
+
+    private:
+        StreamBuf _buf;
+        bool _busy;
+    };
+}
+
+#endif
@@ -0,0 +1,237 @@
+/*
+    日志回溯（飞行记录仪）：
+    1. 日志器开启回溯后，低于输出等级的日志不落地，而是以原始形式保存至定长的环形缓冲区，只保留最近N条
+    2. 到达触发等级的日志输出前，先将缓冲区中的日志按原顺序输出，也可随时主动输出
+    3. 每个线程使用自己的环形缓冲区（各N条），记录日志时只锁定本线程的缓冲区，线程之间没有竞争，
+       输出时按序号合并各线程的日志，保留最近N条
+    4. 线程的缓冲区在首次记录时一次性申请，之后记录日志时不再申请内存，过长的消息被截断，结构化字段与线程上下文不保存
+*/
+#ifndef __M_BACKTRACE_H__
+#define __M_BACKTRACE_H__
+
+#include "level.hpp"
+#include "arena.hpp"
+#include "message.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace logsys
+{
+#define LOG_BACKTRACE_RECORD_SIZE 256
+
+    class Backtrace
+    {
+    public:
+        // 以原始形式保存的一条日志，文件名与消息主体连续存放
+        struct Record
+        {
+            time_t _ctime;
+            uint64_t _seq;
+            LogLevel::value _level;
+            size_t _line;
+            pid_t _tid;
+            char _thread_name[THREAD_NAME_SIZE];
+            uint32_t _file_len;
+            uint32_t _len;
+            char _data[LOG_BACKTRACE_RECORD_SIZE];
+
+            StrRef threadName() const { return StrRef(_thread_name, strlen(_thread_name)); }
+            StrRef file() const { return StrRef(_data, _file_len); }
+            StrRef payload() const { return StrRef(_data + _file_len, _len); }
+        };
+
+        Backtrace() : _trigger(LogLevel::value::OFF), _id(0), _count(0) {}
+
+        ~Backtrace()
+        {
+            retireAll();
+        }
+
+        // 开启回溯，保存最近count条日志，到达trigger等级的日志触发输出
+        void enable(size_t count, LogLevel::value trigger)
+        {
+            std::unique_lock<std::mutex> dump_lock(_dump_mutex);
+            std::unique_lock<std::mutex> lock(_mutex);
+            retireAll();
+            _count = count;
+            _id.store(count > 0 ? nextId() : 0, std::memory_order_release);
+            _trigger = count > 0 ? trigger : LogLevel::value::OFF;
+        }
+
+        void disable()
+        {
+            enable(0, LogLevel::value::OFF);
+        }
+
+        bool enabled() const
+        {
+            return _trigger.load(std::memory_order_relaxed) != LogLevel::value::OFF;
+        }
+
+        // 保存的日志条数，未开启时为0
+        size_t count()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            return _count;
+        }
+
+        // 是否需要在输出该等级的日志前先输出缓冲区
+        bool triggered(LogLevel::value level) const
+        {
+            return level >= _trigger.load(std::memory_order_relaxed);
+        }
+
+        // 保存一条日志至当前线程的缓冲区，缓冲区已满时覆盖该线程最早的日志
+        void push(LogLevel::value level, const char *file, size_t line, const StrRef &msg)
+        {
+            uint64_t id = _id.load(std::memory_order_acquire);
+            if (id == 0)
+                return;
+            Ring *ring = local(id);
+            if (ring == nullptr)
+                return;
+            std::unique_lock<std::mutex> lock(ring->_mutex);
+            Record &rec = ring->_records[(ring->_head + ring->_size) % ring->_records.size()];
+            if (ring->_size == ring->_records.size())
+                ring->_head = (ring->_head + 1) % ring->_records.size();
+            else
+                ring->_size++;
+            rec._ctime = time(nullptr);
+            rec._seq = nextSequence();
+            rec._level = level;
+            rec._line = line;
+            rec._tid = util::Thread::id();
+            memcpy(rec._thread_name, util::Thread::name(), util::Thread::nameSize() + 1);
+            size_t flen = strlen(file);
+            rec._file_len = flen < LOG_BACKTRACE_RECORD_SIZE / 2 ? flen : LOG_BACKTRACE_RECORD_SIZE / 2;
+            memcpy(rec._data, file + flen - rec._file_len, rec._file_len); // 截断时保留文件名的末尾部分
+            size_t avail = LOG_BACKTRACE_RECORD_SIZE - rec._file_len;
+            rec._len = msg.size() < avail ? msg.size() : avail;
+            memcpy(rec._data + rec._file_len, msg.data(), rec._len);
+        }
+
+        // 取出各线程的日志，按序号合并后输出最近count条并清空缓冲区，func在锁外被调用，期间其他线程可继续保存日志
+        template <typename Func>
+        void dump(Func func)
+        {
+            std::unique_lock<std::mutex> dump_lock(_dump_mutex);
+            size_t count;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                count = _count;
+                _snapshot = _rings;
+            }
+            _out.clear();
+            for (auto &ring : _snapshot)
+            {
+                std::unique_lock<std::mutex> guard(ring->_mutex);
+                for (size_t i = 0; i < ring->_size; i++)
+                    _out.push_back(ring->_records[(ring->_head + i) % ring->_records.size()]);
+                ring->_head = 0;
+                ring->_size = 0;
+            }
+            _snapshot.clear();
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                prune();
+            }
+            if (_out.empty())
+                return;
+            std::sort(_out.begin(), _out.end(), [](const Record &a, const Record &b)
+                      { return a._seq < b._seq; });
+            size_t skip = _out.size() > count ? _out.size() - count : 0;
+            for (size_t i = skip; i < _out.size(); i++)
+                func(_out[i]);
+        }
+
+    private:
+        // 一个线程的环形缓冲区，由所属线程写入，只在输出时被其他线程读取，锁几乎没有竞争
+        struct Ring
+        {
+            Ring(size_t count) : _records(count), _head(0), _size(0), _retired(false) {}
+
+            std::mutex _mutex;
+            std::vector<Record> _records;
+            size_t _head;
+            size_t _size;
+            std::atomic<bool> _retired; // 回溯已关闭或重新开启，线程不再使用该缓冲区
+        };
+
+        // 每次开启回溯分配新的编号，线程按编号查找自己的缓冲区，编号不重复使用
+        static uint64_t nextId()
+        {
+            static std::atomic<uint64_t> id(0);
+            return ++id;
+        }
+
+        // 当前线程在编号为id的回溯中的缓冲区，首次使用时创建并登记
+        Ring *local(uint64_t id)
+        {
+            static thread_local std::vector<std::pair<uint64_t, std::shared_ptr<Ring>>> rings;
+            for (auto &item : rings)
+            {
+                if (item.first == id)
+                    return item.second.get();
+            }
+            std::shared_ptr<Ring> ring;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (_id.load(std::memory_order_relaxed) != id)
+                    return nullptr; // 回溯已关闭或重新开启
+                prune();
+                ring = std::make_shared<Ring>(_count);
+                _rings.push_back(ring);
+            }
+            // 顺便移除已失效的缓冲区
+            size_t n = 0;
+            for (size_t i = 0; i < rings.size(); i++)
+            {
+                if (!rings[i].second->_retired.load(std::memory_order_relaxed))
+                    rings[n++] = rings[i];
+            }
+            rings.resize(n);
+            rings.emplace_back(id, ring);
+            return ring.get();
+        }
+
+        // 移除已退出线程的空缓冲区，调用者持有 _mutex
+        void prune()
+        {
+            size_t n = 0;
+            for (size_t i = 0; i < _rings.size(); i++)
+            {
+                std::unique_lock<std::mutex> guard(_rings[i]->_mutex);
+                if (_rings[i].use_count() > 1 || _rings[i]->_size > 0)
+                    _rings[n++] = _rings[i];
+            }
+            _rings.resize(n);
+        }
+
+        // 调用者持有 _mutex 或对象正在析构
+        void retireAll()
+        {
+            for (auto &ring : _rings)
+                ring->_retired.store(true, std::memory_order_relaxed);
+            _rings.clear();
+        }
+
+    private:
+        std::mutex _mutex;      // 保护缓冲区列表与条数
+        std::mutex _dump_mutex; // 同一时间只有一个线程输出缓冲区
+        std::atomic<LogLevel::value> _trigger;
+        std::atomic<uint64_t> _id; // 当前开启的编号，未开启时为0
+        size_t _count;
+        std::vector<std::shared_ptr<Ring>> _rings;    // 各线程的缓冲区
+        std::vector<std::shared_ptr<Ring>> _snapshot; // 输出时的缓冲区列表，避免持有 _mutex 读取各缓冲区
+        std::vector<Record> _out;                     // 输出时合并的日志
+    };
+}
+
+#endif
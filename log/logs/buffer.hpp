@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <cassert>
+#include <cstdint>
+#include <sys/mman.h>
 #include "util.hpp"
 
 namespace logsys
@@ -10,11 +12,39 @@ namespace logsys
 #define DEFAULT_BUFFER_SIZE (10 * 1024 * 1024)
 #define THRESHOLD_BUFFER_SIZE (8 * 1024 * 1024)
 #define INCREMENT_BUFFER_SIZE (1 * 1024 * 1024)
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define NORMAL_PAGE_SIZE 4096
+
+    // 缓冲区内存使用的页面
+    enum class PageType
+    {
+        NORMAL,           // 普通页面
+        TRANSPARENT_HUGE, // 透明大页，按大页对齐并通过 madvise 申请，内核不支持时退化为普通页面
+        EXPLICIT_HUGE     // 预留的大页（MAP_HUGETLB），没有可用的预留大页时退化为透明大页
+    };
+
+    // 缓冲区内存的申请方式，缓冲区在申请时即被全部写入一次，使用过程中不会再触发缺页
+    struct BufferMemory
+    {
+        BufferMemory(PageType pages = PageType::NORMAL, bool lock = false) : _pages(pages), _lock(lock) {}
+        // 默认方式：普通的堆内存
+        bool isDefault() const { return _pages == PageType::NORMAL && !_lock; }
+        PageType _pages;
+        bool _lock; // 锁定在内存中不被换出（mlock），超出进程的锁定上限时忽略
+    };
+
     class Buffer
     {
     public:
-        Buffer() : _buffer(DEFAULT_BUFFER_SIZE), _writer_idx(0), _reader_idx(0)
+        Buffer(size_t size = DEFAULT_BUFFER_SIZE, const BufferMemory &memory = BufferMemory())
+            : _memory(memory), _data(nullptr), _size(0), _mapped(false), _reader_idx(0), _writer_idx(0)
+        {
+            allocate(size);
+        }
+
+        ~Buffer()
         {
+            release(_data, _size, _mapped);
         }
 
         // 向缓冲区写入数据
@@ -23,20 +53,20 @@ namespace logsys
             // 检测空间大小
             ensureEnoughSize(len);
             // 拷贝至缓冲区
-            std::copy(data, data + len, &_buffer[_writer_idx]);
+            std::copy(data, data + len, _data + _writer_idx);
             // 写入位置向后偏移
             moveWriter(len);
         }
 
         size_t writeAbleSize()
         {
-            return (_buffer.size() - _writer_idx);
+            return (_size - _writer_idx);
         }
 
         // 返回可读数据的地址
         const char *begin()
         {
-            return &_buffer[_reader_idx];
+            return _data + _reader_idx;
         }
 
         // 返回可读数据的长度
@@ -62,7 +92,10 @@ namespace logsys
         // 实现交换操作
         void swap(Buffer &buffer)
         {
-            _buffer.swap(buffer._buffer);
+            std::swap(_memory, buffer._memory);
+            std::swap(_data, buffer._data);
+            std::swap(_size, buffer._size);
+            std::swap(_mapped, buffer._mapped);
             std::swap(_reader_idx, buffer._reader_idx);
             std::swap(_writer_idx, buffer._writer_idx);
         }
@@ -73,33 +106,130 @@ namespace logsys
             return (_reader_idx == _writer_idx);
         }
 
+        size_t capacity() const
+        {
+            return _size;
+        }
+
+        // 重新申请size大小的空间，保留可读数据，size 不能小于可读数据的长度
+        void resize(size_t size)
+        {
+            size_t readable = readAbleSize();
+            assert(size >= readable);
+            char *old = _data;
+            size_t old_size = _size;
+            bool old_mapped = _mapped;
+            allocate(size);
+            std::copy(old + _reader_idx, old + _writer_idx, _data);
+            release(old, old_size, old_mapped);
+            _reader_idx = 0;
+            _writer_idx = readable;
+        }
+
     private:
         // 对空间进行扩容
         void ensureEnoughSize(size_t len)
         {
-            if (len < writeAbleSize())
+            if (len <= writeAbleSize())
                 return; // 不需要扩容
             size_t new_size = 0;
-            if (_buffer.size() < THRESHOLD_BUFFER_SIZE)
+            if (_size < THRESHOLD_BUFFER_SIZE)
             {
-                new_size = _buffer.size() * 2 + len; // 翻倍增长
+                new_size = _size * 2 + len; // 翻倍增长
             }
             else
             {
-                new_size = _buffer.size() + INCREMENT_BUFFER_SIZE; // 线性增长
+                new_size = _size + INCREMENT_BUFFER_SIZE; // 线性增长
             }
-            _buffer.resize(new_size);
+            if (new_size < readAbleSize() + len)
+                new_size = readAbleSize() + len;
+            resize(new_size);
+        }
+
+        // 按申请方式申请size大小的内存并写入一次，实际大小可能按页面向上取整
+        void allocate(size_t size)
+        {
+            _data = nullptr;
+            _size = 0;
+            _mapped = false;
+            if (size == 0)
+                return;
+            if (_memory.isDefault())
+            {
+                _data = new char[size]();
+                _size = size;
+                return;
+            }
+            void *addr = MAP_FAILED;
+            size_t huge_size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+            if (_memory._pages == PageType::EXPLICIT_HUGE)
+            {
+                addr = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+                if (addr != MAP_FAILED)
+                    size = huge_size;
+            }
+            if (addr == MAP_FAILED && _memory._pages != PageType::NORMAL)
+            {
+                // 多申请一个大页，截取按大页对齐的部分
+                char *raw = (char *)mmap(nullptr, huge_size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (raw != (char *)MAP_FAILED)
+                {
+                    char *aligned = (char *)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+                    if (aligned > raw)
+                        munmap(raw, aligned - raw);
+                    munmap(aligned + huge_size, raw + HUGE_PAGE_SIZE - aligned);
+                    madvise(aligned, huge_size, MADV_HUGEPAGE);
+                    addr = aligned;
+                    size = huge_size;
+                }
+            }
+            if (addr == MAP_FAILED)
+            {
+                size = (size + NORMAL_PAGE_SIZE - 1) / NORMAL_PAGE_SIZE * NORMAL_PAGE_SIZE;
+                addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            }
+            if (addr == MAP_FAILED)
+            {
+                // 无法映射时使用普通的堆内存
+                _data = new char[size]();
+                _size = size;
+                return;
+            }
+            _data = (char *)addr;
+            _size = size;
+            _mapped = true;
+            // 每个页面写入一次，使页面（透明大页时为整个大页）在此时分配，而不是在输出日志时
+            for (size_t off = 0; off < _size; off += NORMAL_PAGE_SIZE)
+                ((volatile char *)_data)[off] = 0;
+            if (_memory._lock)
+                mlock(_data, _size);
+        }
+
+        static void release(char *data, size_t size, bool mapped)
+        {
+            if (data == nullptr)
+                return;
+            if (mapped)
+                munmap(data, size);
+            else
+                delete[] data;
         }
 
         // 对读写指针进行向后偏移操作
         void moveWriter(size_t len)
         {
-            assert((len + _writer_idx) <= _buffer.size());
+            assert((len + _writer_idx) <= _size);
             _writer_idx += len;
         }
 
     private:
-        std::vector<char> _buffer;
+        Buffer(const Buffer &) = delete;
+        Buffer &operator=(const Buffer &) = delete;
+
+        BufferMemory _memory;
+        char *_data;
+        size_t _size;
+        bool _mapped; // 内存通过 mmap 申请
         size_t _reader_idx; // 当前可读数据的指针--本质是下标
         size_t _writer_idx; // 当前可写数据的指针
     };
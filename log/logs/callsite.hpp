@@ -0,0 +1,146 @@
+/*
+    调用位置统计：
+    1. 日志宏在每个调用位置定义一个静态的 CallSite，记录该位置输出的日志条数，消息字节数与被丢弃的条数
+    2. 计数使用 relaxed 原子操作，CallSite 为常量初始化，没有静态局部变量的初始化检查
+    3. 首次计数时以无锁方式挂入全局链表，CallSite::report 按字节数从大到小输出统计，用于找出输出最多的日志语句
+    注意：丢弃包括被重复日志抑制的日志，以及同步日志器中因异步落地方向队列已满被丢弃的日志
+*/
+#ifndef __M_CALLSITE_H__
+#define __M_CALLSITE_H__
+
+#include "level.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace logsys
+{
+#define LOG_CALLSITE_REPORT_TOP 20 // 报告默认输出的调用位置数量
+
+    class CallSite
+    {
+    public:
+        // 某一时刻的统计快照
+        struct Stat
+        {
+            const char *_file;
+            size_t _line;
+            LogLevel::value _level;
+            uint64_t _records;
+            uint64_t _bytes;
+            uint64_t _dropped;
+        };
+
+        // 在日志输出期间记录当前的调用位置，供同一线程中的落地方向统计丢弃
+        class Scope
+        {
+        public:
+            Scope(CallSite *site) : _prev(current())
+            {
+                current() = site;
+            }
+            ~Scope() { current() = _prev; }
+
+        private:
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+            CallSite *_prev;
+        };
+
+        constexpr CallSite(const char *file, size_t line, LogLevel::value level)
+            : _file(file), _line(line), _level(level), _records(0), _bytes(0), _dropped(0), _registered(false), _next(nullptr)
+        {
+        }
+
+        const char *file() const { return _file; }
+        size_t line() const { return _line; }
+
+        void record(size_t bytes)
+        {
+            enroll();
+            _records.fetch_add(1, std::memory_order_relaxed);
+            _bytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        void drop()
+        {
+            enroll();
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Stat stat() const
+        {
+            Stat st = {_file, _line, _level,
+                       _records.load(std::memory_order_relaxed),
+                       _bytes.load(std::memory_order_relaxed),
+                       _dropped.load(std::memory_order_relaxed)};
+            return st;
+        }
+
+        static CallSite *&current()
+        {
+            static thread_local CallSite *site = nullptr;
+            return site;
+        }
+
+        // 全部已有计数的调用位置，按字节数从大到小排序
+        static std::vector<Stat> snapshot()
+        {
+            std::vector<Stat> res;
+            for (CallSite *site = head().load(std::memory_order_acquire); site != nullptr; site = site->_next)
+                res.push_back(site->stat());
+            std::sort(res.begin(), res.end(), [](const Stat &a, const Stat &b)
+                      { return a._bytes != b._bytes ? a._bytes > b._bytes : a._records > b._records; });
+            return res;
+        }
+
+        // 输出字节数最多的top个调用位置
+        static std::string report(size_t top = LOG_CALLSITE_REPORT_TOP)
+        {
+            std::vector<Stat> stats = snapshot();
+            std::stringstream ss;
+            ss << "调用位置统计（按字节数排序，共 " << stats.size() << " 处）:\n";
+            for (size_t i = 0; i < stats.size() && i < top; i++)
+            {
+                const Stat &st = stats[i];
+                ss << "\t" << st._file << ":" << st._line << " [" << LogLevel::toString(st._level) << "]"
+                   << " 条数: " << st._records << ", 字节数: " << st._bytes << ", 丢弃: " << st._dropped << "\n";
+            }
+            return ss.str();
+        }
+
+    private:
+        // 首次计数时挂入全局链表，之后只有一次 relaxed 读取
+        void enroll()
+        {
+            if (_registered.load(std::memory_order_relaxed) || _registered.exchange(true, std::memory_order_relaxed))
+                return;
+            CallSite *old = head().load(std::memory_order_relaxed);
+            do
+            {
+                _next = old;
+            } while (!head().compare_exchange_weak(old, this, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        static std::atomic<CallSite *> &head()
+        {
+            static std::atomic<CallSite *> list(nullptr);
+            return list;
+        }
+
+    private:
+        const char *_file;
+        size_t _line;
+        LogLevel::value _level;
+        std::atomic<uint64_t> _records;
+        std::atomic<uint64_t> _bytes; // 格式化后的消息主体字节数
+        std::atomic<uint64_t> _dropped;
+        std::atomic<bool> _registered;
+        CallSite *_next; // 挂入链表后不再修改
+    };
+}
+
+#endif
@@ -0,0 +1,512 @@
+/*
+    配置文件加载：
+    1. 从INI格式的配置文件创建日志器并注册至 LoggerManager，已存在的日志器则更新其配置
+    2. 使用 inotify 监视配置文件，文件被修改后重新加载，运行中的日志器原子地替换输出等级，格式化器与落地方向，不阻塞生产者
+    3. 配置有误时保留当前配置不变
+    4. 小节名中的 '.' 表示层级，未配置的等级，格式与落地方向继承自最近的祖先日志器，顶层为 [root]
+    配置示例：
+        # 每个小节对应一个日志器，[root] 为默认日志器
+        [root]
+        level = INFO
+
+        [net]
+        type = async
+        level = DEBUG
+        pattern = [%d{%H:%M:%S}][%c][%p]%T%m%n
+        sink = stdout
+        sink = file ./logs/net.log level=WARN
+        sink = roll ./logs/net- 10485760 async=drop index=1024
+        sink = udp 127.0.0.1 514 format=syslog
+
+        # 继承 net 的格式与落地方向，只调整等级
+        [net.conn]
+        level = WARN
+    日志器配置项：
+        type    sync（默认）/async/shared（共用进程内同一个队列与工作线程的异步日志器），日志器创建后不可更改
+        level   DEBUG/INFO/WARN/ERROR/FATAL/OFF，未配置时继承
+        pattern 格式化规则字符串，与 format 均未配置时继承
+        format  pattern（默认，使用pattern）/json/logfmt/syslog
+        backtrace 回溯保存的日志条数，0（默认）为关闭，ERROR及以上等级的日志触发输出
+        dedup   重复日志抑制的时间窗口（毫秒），0（默认）为关闭
+        sink    落地方向，可出现多次，未配置时继承：stdout | stderr | file 路径 | roll 基础文件名 文件大小 |
+                udp/tcp IP 端口 | unix_dgram/unix_stream 路径，之后可附加选项：
+                level=等级 format=json/logfmt/syslog async=block/drop
+                index=每块日志条数（仅 file/roll，建立稀疏索引）
+*/
+#ifndef __M_CONFIG_H__
+#define __M_CONFIG_H__
+
+#include "logger.hpp"
+#include "socket.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+namespace logsys
+{
+#define CONFIG_POLL_INTERVAL_MS 200
+
+    class Config
+    {
+    public:
+        Config(const std::string &path) : _path(path), _stop(false) {}
+
+        ~Config()
+        {
+            unwatch();
+        }
+
+        // 加载配置文件并应用至日志器，失败时不做任何修改，可通过 lastError() 获取原因
+        bool load()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            std::vector<LoggerConf> loggers;
+            if (parse(loggers) == false)
+                return false;
+
+            // 1. 先创建全部格式化器与落地方向，任一出错则放弃本次加载
+            std::map<std::string, LogSink::ptr> cache;
+            std::vector<Formatter::ptr> formatters;
+            std::vector<std::vector<LogSink::ptr>> sinks(loggers.size());
+            for (size_t i = 0; i < loggers.size(); i++)
+            {
+                // 格式与规则均未配置时为空，继承父日志器的格式化器
+                Formatter::ptr formatter;
+                bool inherit = loggers[i]._format.empty() && loggers[i]._pattern.empty();
+                if (inherit == false)
+                    formatter = createFormatter(loggers[i]._format, loggers[i]._pattern);
+                if (inherit == false && formatter.get() == nullptr)
+                {
+                    _error = "[" + loggers[i]._name + "] 格式化器配置错误";
+                    return false;
+                }
+                formatters.push_back(formatter);
+                for (auto &sc : loggers[i]._sinks)
+                {
+                    LogSink::ptr sink = createSink(loggers[i]._name, sc, cache);
+                    if (sink.get() == nullptr)
+                    {
+                        _error = "[" + loggers[i]._name + "] 落地方向配置错误：" + sc._spec;
+                        return false;
+                    }
+                    sinks[i].push_back(sink);
+                }
+            }
+
+            // 2. 应用至日志器：已存在的日志器替换配置，不存在的日志器创建后注册
+            for (size_t i = 0; i < loggers.size(); i++)
+            {
+                Logger::ptr logger = LoggerManager::getInstance().getLogger(loggers[i]._name);
+                if (logger.get() != nullptr)
+                {
+                    logger->setLevel(loggers[i]._level);
+                    logger->reset(formatters[i], sinks[i]);
+                    // 条数不变时保留回溯缓冲区中的日志，重新开启会将其清空
+                    if (logger->backtraceCount() != loggers[i]._backtrace)
+                    {
+                        if (loggers[i]._backtrace > 0)
+                            logger->enableBacktrace(loggers[i]._backtrace);
+                        else
+                            logger->disableBacktrace();
+                    }
+                    // 时间窗口不变时保留抑制表，重新开启会输出并清空其中的汇总
+                    if (logger->dedupWindow() != loggers[i]._dedup)
+                    {
+                        if (loggers[i]._dedup > 0)
+                            logger->enableDedup(loggers[i]._dedup);
+                        else
+                            logger->disableDedup();
+                    }
+                    continue;
+                }
+                std::unique_ptr<LoggerBuilder> builder(new GlobalLoggerBuilder());
+                builder->buildLoggerName(loggers[i]._name);
+                builder->buildLoggerType(loggers[i]._type);
+                if (loggers[i]._shared)
+                    builder->buildSharedBackend();
+                builder->buildLoggerLevel(loggers[i]._level);
+                builder->buildFormmatter(formatters[i]);
+                builder->buildBacktrace(loggers[i]._backtrace);
+                builder->buildDedup(loggers[i]._dedup);
+                for (auto &sink : sinks[i])
+                    builder->buildSink(sink);
+                builder->build();
+            }
+            // 3. 只保留本次配置中使用的落地方向，被移除的落地方向随旧管线一起释放
+            _sinks.swap(cache);
+            _error.clear();
+            return true;
+        }
+
+        // 启动监视线程，配置文件被修改后自动重新加载
+        bool watch()
+        {
+            if (_thread.joinable())
+                return true;
+            _inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (_inotify_fd < 0)
+                return false;
+            // 监视所在目录而非文件本身，编辑器保存时通常会以新文件替换原文件
+            std::string dir = util::File::path(_path);
+            if (inotify_add_watch(_inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+            {
+                close(_inotify_fd);
+                return false;
+            }
+            _stop = false;
+            _thread = std::thread(&Config::threadEntry, this);
+            return true;
+        }
+
+        void unwatch()
+        {
+            if (_thread.joinable() == false)
+                return;
+            _stop = true;
+            _thread.join();
+            close(_inotify_fd);
+        }
+
+        const std::string &lastError() const
+        {
+            return _error;
+        }
+
+    private:
+        struct SinkConf
+        {
+            std::string _spec;              // 原始配置，同时作为复用落地方向的键
+            std::vector<std::string> _args; // 落地方向类型及其参数
+            LogLevel::value _level;
+            std::string _format;
+            bool _async;
+            OverflowPolicy _policy;
+            size_t _index; // 索引每块的日志条数，0为不建立索引
+        };
+
+        struct LoggerConf
+        {
+            std::string _name;
+            LoggerType _type;
+            bool _shared; // 异步日志器使用共用的后端
+            LogLevel::value _level;
+            std::string _pattern;
+            std::string _format;
+            size_t _backtrace;
+            size_t _dedup; // 重复日志抑制的时间窗口（毫秒）
+            std::vector<SinkConf> _sinks;
+        };
+
+        static std::string trim(const std::string &str)
+        {
+            size_t begin = str.find_first_not_of(" \t\r\n");
+            if (begin == std::string::npos)
+                return "";
+            size_t end = str.find_last_not_of(" \t\r\n");
+            return str.substr(begin, end - begin + 1);
+        }
+
+        bool fail(size_t lineno, const std::string &msg)
+        {
+            std::stringstream ss;
+            ss << _path << ":" << lineno << ": " << msg;
+            _error = ss.str();
+            return false;
+        }
+
+        bool parse(std::vector<LoggerConf> &loggers)
+        {
+            std::ifstream ifs(_path.c_str());
+            if (ifs.is_open() == false)
+            {
+                _error = "打开配置文件失败：" + _path;
+                return false;
+            }
+            std::string line;
+            size_t lineno = 0;
+            while (std::getline(ifs, line))
+            {
+                lineno++;
+                line = trim(line);
+                if (line.empty() || line[0] == '#' || line[0] == ';')
+                    continue;
+                if (line[0] == '[')
+                {
+                    if (line[line.size() - 1] != ']' || line.size() == 2)
+                        return fail(lineno, "小节名错误");
+                    LoggerConf lc;
+                    lc._name = trim(line.substr(1, line.size() - 2));
+                    lc._type = LoggerType::LOGGER_SYNC;
+                    lc._shared = false;
+                    lc._level = LogLevel::value::UNKNOW;
+                    lc._backtrace = 0;
+                    lc._dedup = 0;
+                    loggers.push_back(lc);
+                    continue;
+                }
+                size_t pos = line.find('=');
+                if (pos == std::string::npos)
+                    return fail(lineno, "缺少 '='");
+                if (loggers.empty())
+                    return fail(lineno, "配置项不属于任何日志器");
+                std::string key = trim(line.substr(0, pos));
+                std::string val = trim(line.substr(pos + 1));
+                LoggerConf &lc = loggers.back();
+                if (key == "type")
+                {
+                    if (val == "sync")
+                        lc._type = LoggerType::LOGGER_SYNC;
+                    else if (val == "async")
+                        lc._type = LoggerType::LOGGER_ASYNC;
+                    else if (val == "shared")
+                    {
+                        lc._type = LoggerType::LOGGER_ASYNC;
+                        lc._shared = true;
+                    }
+                    else
+                        return fail(lineno, "未知的日志器类型：" + val);
+                }
+                else if (key == "level")
+                {
+                    if (LogLevel::fromString(val, lc._level) == false)
+                        return fail(lineno, "未知的日志等级：" + val);
+                }
+                else if (key == "pattern")
+                {
+                    lc._pattern = val;
+                }
+                else if (key == "format")
+                {
+                    lc._format = val;
+                }
+                else if (key == "backtrace")
+                {
+                    if (toNumber(val, lc._backtrace) == false)
+                        return fail(lineno, "回溯条数错误：" + val);
+                }
+                else if (key == "dedup")
+                {
+                    if (toNumber(val, lc._dedup) == false)
+                        return fail(lineno, "重复日志抑制窗口错误：" + val);
+                }
+                else if (key == "sink")
+                {
+                    SinkConf sc;
+                    if (parseSink(val, sc) == false)
+                        return fail(lineno, "落地方向配置错误：" + val);
+                    lc._sinks.push_back(sc);
+                }
+                else
+                {
+                    return fail(lineno, "未知的配置项：" + key);
+                }
+            }
+            return true;
+        }
+
+        // 解析落地方向：类型与参数，之后为 key=value 形式的选项
+        static bool parseSink(const std::string &spec, SinkConf &sc)
+        {
+            sc._spec = spec;
+            sc._level = LogLevel::value::UNKNOW;
+            sc._async = false;
+            sc._policy = OverflowPolicy::BLOCK;
+            sc._index = 0;
+            std::stringstream ss(spec);
+            std::string token;
+            while (ss >> token)
+            {
+                size_t pos = token.find('=');
+                if (pos == std::string::npos)
+                {
+                    sc._args.push_back(token);
+                    continue;
+                }
+                std::string key = token.substr(0, pos);
+                std::string val = token.substr(pos + 1);
+                if (key == "level")
+                {
+                    if (LogLevel::fromString(val, sc._level) == false)
+                        return false;
+                }
+                else if (key == "format")
+                {
+                    sc._format = val;
+                }
+                else if (key == "async")
+                {
+                    sc._async = true;
+                    if (val == "block")
+                        sc._policy = OverflowPolicy::BLOCK;
+                    else if (val == "drop")
+                        sc._policy = OverflowPolicy::DROP;
+                    else
+                        return false;
+                }
+                else if (key == "index")
+                {
+                    if (toNumber(val, sc._index) == false || sc._index == 0)
+                        return false;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            return sc._args.empty() == false;
+        }
+
+        static Formatter::ptr createFormatter(const std::string &format, const std::string &pattern)
+        {
+            if (format.empty() || format == "pattern")
+            {
+                if (Formatter::check(pattern) == false)
+                    return Formatter::ptr();
+                return std::make_shared<Formatter>(pattern);
+            }
+            if (format == "json")
+                return std::make_shared<JsonFormatter>();
+            if (format == "logfmt")
+                return std::make_shared<LogfmtFormatter>();
+            if (format == "syslog")
+                return std::make_shared<SyslogFormatter>();
+            return Formatter::ptr();
+        }
+
+        static bool toNumber(const std::string &str, size_t &num)
+        {
+            char *end = nullptr;
+            errno = 0;
+            unsigned long long val = strtoull(str.c_str(), &end, 10);
+            if (str.empty() || *end != '\0' || errno != 0)
+                return false;
+            num = val;
+            return true;
+        }
+
+        // 创建落地方向，同一日志器中配置未变化的落地方向直接复用，避免重新打开文件或连接
+        LogSink::ptr createSink(const std::string &logger, const SinkConf &sc, std::map<std::string, LogSink::ptr> &cache)
+        {
+            // 等级与格式化器设置在每次加载新建的视图上，不参与复用的判断
+            std::string key = logger + "\n" + (sc._async ? (sc._policy == OverflowPolicy::DROP ? "drop\n" : "block\n") : "\n");
+            for (auto &arg : sc._args)
+                key += arg + " ";
+            if (sc._index > 0)
+                key += "index=" + std::to_string(sc._index);
+            LogSink::ptr sink;
+            auto it = _sinks.find(key);
+            if (it != _sinks.end())
+                sink = it->second;
+            else if (cache.count(key))
+                return LogSink::ptr(); // 同一日志器中重复的落地方向
+            else
+                sink = newSink(sc);
+            if (sink.get() == nullptr)
+                return sink;
+            // 复用的落地方向正在被日志器使用，加载成功前不能修改，新的等级与格式化器随视图在应用阶段一起生效
+            LogSink::ptr view = std::make_shared<SinkView>(sink);
+            if (sc._format.empty() == false)
+            {
+                Formatter::ptr formatter = createFormatter(sc._format, "");
+                if (formatter.get() == nullptr || sc._format == "pattern")
+                    return LogSink::ptr();
+                view->setFormatter(formatter);
+            }
+            view->setLevel(sc._level);
+            cache[key] = sink;
+            return view;
+        }
+
+        static LogSink::ptr newSink(const SinkConf &sc)
+        {
+            const std::vector<std::string> &args = sc._args;
+            const std::string &type = args[0];
+            LogSink::ptr sink;
+            size_t num = 0;
+            if (sc._index > 0 && type != "file" && type != "roll")
+                return sink;
+            if (type == "stdout" && args.size() == 1)
+            {
+                sink = SinkFactory::create<StdoutSink>();
+            }
+            else if (type == "stderr" && args.size() == 1)
+            {
+                sink = SinkFactory::create<StderrSink>();
+            }
+            else if (type == "file" && args.size() == 2)
+            {
+                sink = SinkFactory::create<FileSink>(args[1], sc._index);
+            }
+            else if (type == "roll" && args.size() == 3 && toNumber(args[2], num) && num > 0)
+            {
+                sink = SinkFactory::create<RollBySizeSink>(args[1], num, sc._index);
+            }
+            else if ((type == "udp" || type == "tcp") && args.size() == 3 && toNumber(args[2], num) && num <= 65535)
+            {
+                in_addr addr;
+                if (inet_pton(AF_INET, args[1].c_str(), &addr) != 1)
+                    return sink;
+                if (type == "udp")
+                    sink = SinkFactory::create<UdpSink>(args[1], (uint16_t)num);
+                else
+                    sink = SinkFactory::create<TcpSink>(args[1], (uint16_t)num);
+            }
+            else if ((type == "unix_dgram" || type == "unix_stream") && args.size() == 2 && args[1].size() < sizeof(((sockaddr_un *)0)->sun_path))
+            {
+                if (type == "unix_dgram")
+                    sink = SinkFactory::create<UnixDgramSink>(args[1]);
+                else
+                    sink = SinkFactory::create<UnixStreamSink>(args[1]);
+            }
+            if (sink.get() != nullptr && sc._async)
+                sink = std::make_shared<AsyncSink>(sink, sc._policy);
+            return sink;
+        }
+
+        // 监视线程：配置文件所在目录中有文件写入完毕或被移入时，若是配置文件则重新加载
+        void threadEntry()
+        {
+            std::string name = _path.substr(_path.find_last_of('/') == std::string::npos ? 0 : _path.find_last_of('/') + 1);
+            char buf[4096] __attribute__((aligned(__alignof__(inotify_event))));
+            while (_stop == false)
+            {
+                pollfd pfd = {_inotify_fd, POLLIN, 0};
+                if (poll(&pfd, 1, CONFIG_POLL_INTERVAL_MS) <= 0)
+                    continue;
+                bool changed = false;
+                ssize_t len;
+                while ((len = read(_inotify_fd, buf, sizeof(buf))) > 0)
+                {
+                    for (char *ptr = buf; ptr < buf + len;)
+                    {
+                        inotify_event *ev = (inotify_event *)ptr;
+                        if (ev->len > 0 && name == ev->name)
+                            changed = true;
+                        ptr += sizeof(inotify_event) + ev->len;
+                    }
+                }
+                if (changed && load() == false)
+                    std::cout << "重新加载配置失败：" << lastError() << std::endl;
+            }
+        }
+
+    private:
+        std::string _path;
+        std::string _error;
+        std::mutex _mutex;
+        std::map<std::string, LogSink::ptr> _sinks; // 当前配置中使用的落地方向
+        int _inotify_fd;
+        std::atomic<bool> _stop;
+        std::thread _thread;
+    };
+}
+
+#endif
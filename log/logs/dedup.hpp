@@ -0,0 +1,257 @@
+/*
+    重复日志抑制：
+    1. 以调用位置（文件与行号）和消息主体的散列为键，同一条日志在时间窗口内只输出第一次，之后的重复只计数
+    2. 窗口结束后再次出现，或被定期检查发现时，输出一条 "重复 N 次: 消息" 的汇总日志
+    3. 定长的直接映射表，开启时一次性申请，键冲突时覆盖旧条目（先输出其汇总），内存占用固定
+    4. 表按下标分段加锁，生产者只在自己的分段上短暂持锁
+*/
+#ifndef __M_DEDUP_H__
+#define __M_DEDUP_H__
+
+#include "level.hpp"
+#include "arena.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace logsys
+{
+#define LOG_DEDUP_SLOTS 1024      // 默认的表大小，向上取整为2的幂
+#define LOG_DEDUP_WINDOW_MS 1000  // 默认的时间窗口
+#define LOG_DEDUP_TEXT_SIZE 128   // 汇总日志中保留的消息长度
+#define LOG_DEDUP_STRIPES 16      // 锁分段数量
+
+    class Dedup
+    {
+    public:
+        // 需要输出的汇总
+        struct Summary
+        {
+            LogLevel::value _level;
+            const char *_file;
+            size_t _line;
+            uint64_t _count; // 被抑制的次数
+            uint32_t _len;
+            char _text[LOG_DEDUP_TEXT_SIZE];
+
+            StrRef text() const { return StrRef(_text, _len); }
+        };
+
+        Dedup() : _window(0), _next_sweep(0) {}
+
+        // 开启抑制，window_ms 为时间窗口，slots 为表大小
+        void enable(size_t window_ms, size_t slots = LOG_DEDUP_SLOTS)
+        {
+            // 表大小不小于分段数量，下标对分段数量取模与散列值对分段数量取模相同
+            size_t size = LOG_DEDUP_STRIPES;
+            while (size < slots)
+                size <<= 1;
+            lockAll();
+            _slots.assign(size, Slot());
+            _window.store(window_ms, std::memory_order_relaxed);
+            _next_sweep.store(now() + window_ms, std::memory_order_relaxed);
+            unlockAll();
+        }
+
+        // 关闭抑制，尚未输出的汇总交给 emit
+        template <typename Func>
+        void disable(Func emit)
+        {
+            drain(emit);
+            lockAll();
+            std::vector<Slot>().swap(_slots);
+            _window.store(0, std::memory_order_relaxed);
+            unlockAll();
+        }
+
+        bool enabled() const
+        {
+            return _window.load(std::memory_order_relaxed) > 0;
+        }
+
+        // 时间窗口（毫秒），未开启时为0
+        size_t window() const
+        {
+            return _window.load(std::memory_order_relaxed);
+        }
+
+        // 判断日志是否需要输出，返回false表示被抑制，需要输出的汇总在锁外交给 emit
+        template <typename Func>
+        bool admit(LogLevel::value level, const char *file, size_t line, const StrRef &msg, Func emit)
+        {
+            int64_t t = now();
+            int64_t window = (int64_t)_window.load(std::memory_order_relaxed);
+            sweep(t, window, emit);
+            uint64_t h = hash(msg.data(), msg.size()) ^ ((uint64_t)(uintptr_t)file * 0x9E3779B97F4A7C15ULL) ^ ((uint64_t)line * 0xC2B2AE3D27D4EB4FULL);
+            Summary sum;
+            bool has_sum = false;
+            bool pass = true;
+            {
+                std::unique_lock<std::mutex> lock(_stripes[h % LOG_DEDUP_STRIPES]);
+                if (_slots.empty())
+                    return true;
+                Slot &s = _slots[h & (_slots.size() - 1)];
+                if (s._file != nullptr)
+                {
+                    if (s._hash == h && s._file == file && s._line == line)
+                    {
+                        if (t - s._start < window)
+                        {
+                            s._count++;
+                            return false;
+                        }
+                        // 窗口已结束，仍在重复则以汇总代替本条日志，否则本条日志作为新窗口的第一条输出
+                        if (s._count > 0)
+                        {
+                            s._count++;
+                            has_sum = summarize(s, sum);
+                            pass = false;
+                        }
+                        s._start = t;
+                    }
+                    else
+                    {
+                        // 键冲突，覆盖旧条目前输出其汇总
+                        has_sum = summarize(s, sum);
+                        fill(s, h, level, file, line, msg, t);
+                    }
+                }
+                else
+                {
+                    fill(s, h, level, file, line, msg, t);
+                }
+            }
+            if (has_sum)
+                emit(sum);
+            return pass;
+        }
+
+        // 输出全部尚未输出的汇总，如刷新日志器时
+        template <typename Func>
+        void drain(Func emit)
+        {
+            collect(now(), -1, emit);
+        }
+
+    private:
+        struct Slot
+        {
+            Slot() : _hash(0), _level(LogLevel::value::UNKNOW), _file(nullptr), _line(0), _start(0), _count(0), _len(0) {}
+            uint64_t _hash;
+            LogLevel::value _level;
+            const char *_file; // 为nullptr表示空闲
+            size_t _line;
+            int64_t _start;  // 当前窗口的开始时间
+            uint64_t _count; // 当前窗口内被抑制的次数
+            uint32_t _len;
+            char _text[LOG_DEDUP_TEXT_SIZE];
+        };
+
+        static int64_t now()
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        }
+
+        // 每次处理8字节的散列，只用于判断重复，不要求抗碰撞
+        static uint64_t hash(const char *data, size_t len)
+        {
+            uint64_t h = len * 0x9E3779B97F4A7C15ULL;
+            size_t i = 0;
+            for (; i + 8 <= len; i += 8)
+            {
+                uint64_t v;
+                memcpy(&v, data + i, 8);
+                h = (h ^ v) * 0xFF51AFD7ED558CCDULL;
+                h ^= h >> 32;
+            }
+            uint64_t v = 0;
+            memcpy(&v, data + i, len - i);
+            h = (h ^ v) * 0xC4CEB9FE1A85EC53ULL;
+            return h ^ (h >> 29);
+        }
+
+        static void fill(Slot &s, uint64_t h, LogLevel::value level, const char *file, size_t line, const StrRef &msg, int64_t t)
+        {
+            s._hash = h;
+            s._level = level;
+            s._file = file;
+            s._line = line;
+            s._start = t;
+            s._count = 0;
+            s._len = msg.size() < LOG_DEDUP_TEXT_SIZE ? msg.size() : LOG_DEDUP_TEXT_SIZE;
+            memcpy(s._text, msg.data(), s._len);
+        }
+
+        // 条目有被抑制的日志时生成汇总并清零计数
+        static bool summarize(Slot &s, Summary &sum)
+        {
+            if (s._count == 0)
+                return false;
+            sum._level = s._level;
+            sum._file = s._file;
+            sum._line = s._line;
+            sum._count = s._count;
+            sum._len = s._len;
+            memcpy(sum._text, s._text, s._len);
+            s._count = 0;
+            return true;
+        }
+
+        // 每个窗口由一个生产者检查一次整张表，输出已超出窗口的汇总，避免重复停止后计数一直不输出
+        template <typename Func>
+        void sweep(int64_t t, int64_t window, Func emit)
+        {
+            int64_t next = _next_sweep.load(std::memory_order_relaxed);
+            if (t < next || !_next_sweep.compare_exchange_strong(next, t + window, std::memory_order_relaxed))
+                return;
+            collect(t, window, emit);
+        }
+
+        // 收集窗口已结束（window 为负时为全部）且有计数的条目的汇总，在锁外输出
+        template <typename Func>
+        void collect(int64_t t, int64_t window, Func emit)
+        {
+            std::vector<Summary> sums;
+            for (size_t stripe = 0; stripe < LOG_DEDUP_STRIPES; stripe++)
+            {
+                std::unique_lock<std::mutex> lock(_stripes[stripe]);
+                for (size_t i = stripe; i < _slots.size(); i += LOG_DEDUP_STRIPES)
+                {
+                    Slot &s = _slots[i];
+                    if (s._count == 0 || (window >= 0 && t - s._start < window))
+                        continue;
+                    sums.push_back(Summary());
+                    summarize(s, sums.back());
+                    s._start = t;
+                }
+            }
+            for (auto &sum : sums)
+                emit(sum);
+        }
+
+        void lockAll()
+        {
+            for (size_t i = 0; i < LOG_DEDUP_STRIPES; i++)
+                _stripes[i].lock();
+        }
+
+        void unlockAll()
+        {
+            for (size_t i = LOG_DEDUP_STRIPES; i > 0; i--)
+                _stripes[i - 1].unlock();
+        }
+
+    private:
+        std::mutex _stripes[LOG_DEDUP_STRIPES]; // 下标为i的条目由 _stripes[i % LOG_DEDUP_STRIPES] 保护
+        std::vector<Slot> _slots;
+        std::atomic<size_t> _window;      // 为0表示未开启
+        std::atomic<int64_t> _next_sweep; // 下一次检查整张表的时间
+    };
+}
+
+#endif
@@ -0,0 +1,157 @@
+/*
+    基于纪元的延迟回收：用于无锁地读取运行期会被整体替换的对象（如日志器的输出管线）
+    1. 读者在 Epoch::Guard 的作用域内读取原始指针并使用对象，进入时只写本线程的槽位，读者之间不共享任何可写的缓存行
+    2. 写者原子地替换指针后调用 synchronize()，推进全局纪元并等待替换前进入的读者全部离开，之后即可释放旧对象
+    3. 替换很少发生，synchronize 以让出CPU的方式等待，读者的作用域可以嵌套
+*/
+#ifndef __M_EPOCH_H__
+#define __M_EPOCH_H__
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace logsys
+{
+    class Epoch
+    {
+    private:
+        // 每个线程一个槽位：所在作用域进入时的纪元，不在作用域内时为0，填充至缓存行大小，减少与其他数据共享缓存行
+        struct Slot
+        {
+            Slot() : _epoch(0), _depth(0) {}
+            std::atomic<uint64_t> _epoch;
+            size_t _depth; // 作用域的嵌套层数，只由所属线程访问
+            char _pad[64 - sizeof(std::atomic<uint64_t>) - sizeof(size_t)];
+        };
+
+    public:
+        // 读者的作用域：离开之前读取到的对象不会被释放
+        class Guard
+        {
+        public:
+            Guard() : _slot(Epoch::local())
+            {
+                // 顺序一致的写入：写者读取槽位与读者读取指针（同样顺序一致）之间至少有一方能看到对方的写入
+                if (_slot._depth++ == 0)
+                    _slot._epoch.exchange(Epoch::global().load(std::memory_order_acquire), std::memory_order_seq_cst);
+            }
+
+            ~Guard()
+            {
+                if (--_slot._depth == 0)
+                    _slot._epoch.store(0, std::memory_order_release);
+            }
+
+        private:
+            Guard(const Guard &) = delete;
+            Guard &operator=(const Guard &) = delete;
+
+            Slot &_slot;
+        };
+
+        // 等待在此之前进入作用域的读者全部离开，调用者不能处于 Guard 的作用域内
+        // 写者以顺序一致的方式替换指针后调用，读者在作用域内以顺序一致的方式读取指针
+        static void synchronize()
+        {
+            uint64_t epoch = global().fetch_add(1, std::memory_order_seq_cst) + 1;
+            Registry &reg = registry();
+            std::unique_lock<std::mutex> lock(reg._mutex);
+            for (auto &slot : reg._slots)
+            {
+                while (true)
+                {
+                    uint64_t e = slot->_epoch.load(std::memory_order_seq_cst);
+                    if (e == 0 || e >= epoch)
+                        break;
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+    private:
+        // 槽位只增不减，线程退出时归还，由之后的线程复用
+        struct Registry
+        {
+            std::mutex _mutex;
+            std::vector<Slot *> _slots;
+            std::vector<Slot *> _free;
+        };
+
+        // 线程局部的槽位指针，不需要构造与析构，进程退出阶段（线程局部对象已析构后）仍可使用
+        struct Local
+        {
+            Slot *_slot;
+            bool _exited; // 线程局部对象已析构，之后取得的槽位不再归还
+        };
+
+        // 线程退出时归还槽位
+        struct Releaser
+        {
+            ~Releaser()
+            {
+                Local &l = tls();
+                if (l._slot != nullptr && l._slot->_depth == 0)
+                {
+                    Registry &reg = registry();
+                    std::unique_lock<std::mutex> lock(reg._mutex);
+                    reg._free.push_back(l._slot);
+                    l._slot = nullptr;
+                }
+                l._exited = true;
+            }
+        };
+
+        // 从1开始，槽位为0表示不在作用域内
+        static std::atomic<uint64_t> &global()
+        {
+            static std::atomic<uint64_t> epoch(1);
+            return epoch;
+        }
+
+        static Registry &registry()
+        {
+            static Registry *reg = new Registry(); // 不析构，进程退出阶段仍可访问
+            return *reg;
+        }
+
+        static Local &tls()
+        {
+            static __thread Local local;
+            return local;
+        }
+
+        // 线程首次进入作用域时取得槽位
+        static Slot &local()
+        {
+            Local &l = tls();
+            if (l._slot == nullptr)
+            {
+                Registry &reg = registry();
+                {
+                    std::unique_lock<std::mutex> lock(reg._mutex);
+                    if (reg._free.empty())
+                    {
+                        reg._slots.push_back(new Slot());
+                        l._slot = reg._slots.back();
+                    }
+                    else
+                    {
+                        l._slot = reg._free.back();
+                        reg._free.pop_back();
+                    }
+                }
+                if (l._exited == false)
+                {
+                    static thread_local Releaser releaser;
+                    (void)releaser;
+                }
+            }
+            return *l._slot;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,229 @@
+/*
+    转义工具：
+    1. 使用SIMD（AVX2/SSE2，不支持时退化为逐字节扫描）批量查找需要转义的字符，无需转义的连续片段整体拷贝
+    2. 提供文本行转义，JSON字符串转义与logfmt取值转义
+    3. 输出对象只需提供 write(const char *, size_t) 接口，std::ostream 可直接使用
+*/
+#ifndef __M_ESCAPE_H__
+#define __M_ESCAPE_H__
+
+#include <ostream>
+#include <cstddef>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LOGSYS_HAVE_X86_SIMD 1
+#endif
+
+namespace logsys
+{
+    namespace util
+    {
+        class Escape
+        {
+        public:
+            // 返回第一个需要文本转义的字节下标（控制字符，DEL与反斜杠），不存在则返回len
+            static size_t findText(const char *data, size_t len)
+            {
+                return scan(data, len, 0x1f, 0x7f, '\\', 0x7f);
+            }
+
+            // 返回第一个需要JSON转义的字节下标（控制字符，双引号，反斜杠），不存在则返回len
+            static size_t findJson(const char *data, size_t len)
+            {
+                return scan(data, len, 0x1f, '"', '\\', '"');
+            }
+
+            // 返回第一个需要logfmt加引号的字节下标（空白与控制字符，双引号，等号，反斜杠），不存在则返回len
+            static size_t findLogfmt(const char *data, size_t len)
+            {
+                return scan(data, len, 0x20, '"', '\\', '=');
+            }
+
+            // 转义换行与控制字符，保证一条日志只占一行；反斜杠转义为 \\，与转义序列区分
+            template <typename Out>
+            static void text(Out &out, const char *data, size_t len)
+            {
+                size_t pos = 0;
+                while (pos < len)
+                {
+                    size_t n = findText(data + pos, len - pos);
+                    if (n > 0)
+                        out.write(data + pos, n);
+                    pos += n;
+                    if (pos == len)
+                        break;
+                    writeTextChar(out, data[pos++]);
+                }
+            }
+
+            // 按JSON字符串规则输出转义后的内容（不包含两侧引号）
+            template <typename Out>
+            static void json(Out &out, const char *data, size_t len)
+            {
+                size_t pos = 0;
+                while (pos < len)
+                {
+                    size_t n = findJson(data + pos, len - pos);
+                    // 无需转义的片段整体写入
+                    if (n > 0)
+                        out.write(data + pos, n);
+                    pos += n;
+                    if (pos == len)
+                        break;
+                    writeJsonChar(out, data[pos++]);
+                }
+            }
+
+            // 按logfmt规则输出取值，包含特殊字符或为空时加引号
+            template <typename Out>
+            static void logfmt(Out &out, const char *data, size_t len)
+            {
+                if (len > 0 && findLogfmt(data, len) == len)
+                {
+                    out.write(data, len);
+                    return;
+                }
+                out.write("\"", 1);
+                json(out, data, len);
+                out.write("\"", 1);
+            }
+
+        private:
+            template <typename Out>
+            static void writeTextChar(Out &out, char c)
+            {
+                switch (c)
+                {
+                case '\n':
+                    out.write("\\n", 2);
+                    return;
+                case '\r':
+                    out.write("\\r", 2);
+                    return;
+                case '\t':
+                    out.write("\\t", 2);
+                    return;
+                case '\\':
+                    out.write("\\\\", 2);
+                    return;
+                }
+                char tmp[4] = {'\\', 'x', hex((unsigned char)c >> 4), hex(c & 0xf)};
+                out.write(tmp, 4);
+            }
+
+            template <typename Out>
+            static void writeJsonChar(Out &out, char c)
+            {
+                switch (c)
+                {
+                case '"':
+                    out.write("\\\"", 2);
+                    return;
+                case '\\':
+                    out.write("\\\\", 2);
+                    return;
+                case '\n':
+                    out.write("\\n", 2);
+                    return;
+                case '\r':
+                    out.write("\\r", 2);
+                    return;
+                case '\t':
+                    out.write("\\t", 2);
+                    return;
+                case '\b':
+                    out.write("\\b", 2);
+                    return;
+                case '\f':
+                    out.write("\\f", 2);
+                    return;
+                }
+                char tmp[6] = {'\\', 'u', '0', '0', hex((unsigned char)c >> 4), hex(c & 0xf)};
+                out.write(tmp, 6);
+            }
+
+            static char hex(int v)
+            {
+                return "0123456789abcdef"[v & 0xf];
+            }
+
+            // 查找第一个 <= ctl 或等于 a/b/c 的字节，按CPU能力选择实现
+            static size_t scan(const char *data, size_t len, unsigned char ctl, char a, char b, char c)
+            {
+#if defined(LOGSYS_HAVE_X86_SIMD)
+                if (len >= 32 && hasAvx2())
+                    return scanAvx2(data, len, ctl, a, b, c);
+                if (len >= 16)
+                    return scanSse2(data, len, ctl, a, b, c);
+#endif
+                return scanScalar(data, 0, len, ctl, a, b, c);
+            }
+
+            static size_t scanScalar(const char *data, size_t i, size_t len, unsigned char ctl, char a, char b, char c)
+            {
+                for (; i < len; i++)
+                {
+                    unsigned char ch = (unsigned char)data[i];
+                    if (ch <= ctl || ch == (unsigned char)a || ch == (unsigned char)b || ch == (unsigned char)c)
+                        return i;
+                }
+                return len;
+            }
+
+#if defined(LOGSYS_HAVE_X86_SIMD)
+            static bool hasAvx2()
+            {
+                static const bool avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+                return avx2;
+            }
+
+            __attribute__((target("sse2"))) static size_t scanSse2(const char *data, size_t len, unsigned char ctl, char a, char b, char c)
+            {
+                const __m128i vctl = _mm_set1_epi8((char)ctl);
+                const __m128i va = _mm_set1_epi8(a);
+                const __m128i vb = _mm_set1_epi8(b);
+                const __m128i vc = _mm_set1_epi8(c);
+                size_t i = 0;
+                for (; i + 16 <= len; i += 16)
+                {
+                    __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+                    // 无符号比较 v <= ctl 等价于 min(v, ctl) == v
+                    __m128i m = _mm_cmpeq_epi8(_mm_min_epu8(v, vctl), v);
+                    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, va));
+                    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, vb));
+                    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, vc));
+                    int mask = _mm_movemask_epi8(m);
+                    if (mask != 0)
+                        return i + __builtin_ctz(mask);
+                }
+                return scanScalar(data, i, len, ctl, a, b, c);
+            }
+
+            __attribute__((target("avx2"))) static size_t scanAvx2(const char *data, size_t len, unsigned char ctl, char a, char b, char c)
+            {
+                const __m256i vctl = _mm256_set1_epi8((char)ctl);
+                const __m256i va = _mm256_set1_epi8(a);
+                const __m256i vb = _mm256_set1_epi8(b);
+                const __m256i vc = _mm256_set1_epi8(c);
+                size_t i = 0;
+                for (; i + 32 <= len; i += 32)
+                {
+                    __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+                    __m256i m = _mm256_cmpeq_epi8(_mm256_min_epu8(v, vctl), v);
+                    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, va));
+                    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, vb));
+                    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, vc));
+                    unsigned int mask = (unsigned int)_mm256_movemask_epi8(m);
+                    if (mask != 0)
+                        return i + __builtin_ctz(mask);
+                }
+                // 剩余不足32字节的部分交给SSE2与逐字节扫描
+                size_t n = scanSse2(data + i, len - i, ctl, a, b, c);
+                return i + n;
+            }
+#endif
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,101 @@
+/*
+    结构化日志字段：
+    1. Field 保存一个带类型的键值对（整数，浮点，字符串，布尔）
+    2. Fields 以定长数组内联保存一条日志的全部字段，不进行堆内存申请
+    注意：键与字符串取值只保存指针，需保证在日志调用返回前有效
+*/
+#ifndef __M_FIELD_H__
+#define __M_FIELD_H__
+
+#include <string>
+#include <cstring>
+#include <initializer_list>
+
+namespace logsys
+{
+#define LOG_MAX_FIELDS 8
+    struct Field
+    {
+        enum class Type
+        {
+            INT,
+            UINT,
+            DOUBLE,
+            STRING,
+            BOOL
+        };
+
+        const char *_key;
+        Type _type;
+        union
+        {
+            long long _int;
+            unsigned long long _uint;
+            double _double;
+            bool _bool;
+            struct
+            {
+                const char *_data;
+                size_t _size;
+            } _str;
+        };
+
+        Field() {}
+        Field(const char *key, int val) : _key(key), _type(Type::INT), _int(val) {}
+        Field(const char *key, long val) : _key(key), _type(Type::INT), _int(val) {}
+        Field(const char *key, long long val) : _key(key), _type(Type::INT), _int(val) {}
+        Field(const char *key, unsigned int val) : _key(key), _type(Type::UINT), _uint(val) {}
+        Field(const char *key, unsigned long val) : _key(key), _type(Type::UINT), _uint(val) {}
+        Field(const char *key, unsigned long long val) : _key(key), _type(Type::UINT), _uint(val) {}
+        Field(const char *key, float val) : _key(key), _type(Type::DOUBLE), _double(val) {}
+        Field(const char *key, double val) : _key(key), _type(Type::DOUBLE), _double(val) {}
+        Field(const char *key, bool val) : _key(key), _type(Type::BOOL), _bool(val) {}
+        Field(const char *key, const char *val) : _key(key), _type(Type::STRING)
+        {
+            _str._data = val ? val : "";
+            _str._size = val ? strlen(val) : 0;
+        }
+        Field(const char *key, const std::string &val) : _key(key), _type(Type::STRING)
+        {
+            _str._data = val.c_str();
+            _str._size = val.size();
+        }
+    };
+
+    class Fields
+    {
+    public:
+        Fields() : _size(0) {}
+        Fields(std::initializer_list<Field> fields) : _size(0)
+        {
+            for (const auto &f : fields)
+            {
+                if (_size == LOG_MAX_FIELDS)
+                    break;
+                _items[_size++] = f;
+            }
+        }
+
+        // 追加一个字段，超过上限的字段被忽略
+        template <typename T>
+        Fields &add(const char *key, const T &val)
+        {
+            if (_size < LOG_MAX_FIELDS)
+            {
+                _items[_size++] = Field(key, val);
+            }
+            return *this;
+        }
+
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        const Field *begin() const { return _items; }
+        const Field *end() const { return _items + _size; }
+
+    private:
+        Field _items[LOG_MAX_FIELDS];
+        size_t _size;
+    };
+}
+
+#endif
@@ -4,6 +4,11 @@
 
 #include "level.hpp"
 #include "message.hpp"
+#include "escape.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <unistd.h>
 #include <ctime>
 #include <memory>
 #include <vector>
@@ -24,10 +29,36 @@ namespace logsys
     class MsgFormatItem : public FormatItem
     {
     public:
+        // 子规则指定消息主体的转义方式：
+        //   %m        原样输出
+        //   %m{text}  转义换行与控制字符，防止不可信内容破坏按行解析
+        //   %m{json}  按JSON字符串规则转义
+        MsgFormatItem(const std::string &mode = "")
+            : _mode(ESCAPE_NONE)
+        {
+            if (mode == "text")
+                _mode = ESCAPE_TEXT;
+            else if (mode == "json")
+                _mode = ESCAPE_JSON;
+        }
         void format(std::ostream &out, const LogMsg &msg) override
         {
-            out << msg._payload;
+            if (_mode == ESCAPE_NONE)
+                out << msg._payload;
+            else if (_mode == ESCAPE_TEXT)
+                util::Escape::text(out, msg._payload.data(), msg._payload.size());
+            else
+                util::Escape::json(out, msg._payload.data(), msg._payload.size());
         }
+
+    private:
+        enum EscapeMode
+        {
+            ESCAPE_NONE,
+            ESCAPE_TEXT,
+            ESCAPE_JSON
+        };
+        EscapeMode _mode;
     };
 
     class LevelFormatItem : public FormatItem
@@ -84,6 +115,24 @@ namespace logsys
         }
     };
 
+    class ThreadNameFormatItem : public FormatItem
+    {
+    public:
+        void format(std::ostream &out, const LogMsg &msg) override
+        {
+            out << msg._thread_name;
+        }
+    };
+
+    class SeqFormatItem : public FormatItem
+    {
+    public:
+        void format(std::ostream &out, const LogMsg &msg) override
+        {
+            out << msg._seq;
+        }
+    };
+
     class LoggerFormatItem : public FormatItem
     {
     public:
@@ -93,6 +142,122 @@ namespace logsys
         }
     };
 
+    // 结构化字段取值的输出工具，数值直接格式化到栈上缓冲区
+    class FieldWriter
+    {
+    public:
+        static void json(std::ostream &out, const Field &f)
+        {
+            switch (f._type)
+            {
+            case Field::Type::STRING:
+                out.put('"');
+                util::Escape::json(out, f._str._data, f._str._size);
+                out.put('"');
+                return;
+            case Field::Type::BOOL:
+                out << (f._bool ? "true" : "false");
+                return;
+            case Field::Type::DOUBLE:
+                // JSON不支持 NaN/Inf
+                if (!std::isfinite(f._double))
+                    out << "null";
+                else
+                    number(out, f);
+                return;
+            default:
+                number(out, f);
+            }
+        }
+
+        static void logfmt(std::ostream &out, const Field &f)
+        {
+            switch (f._type)
+            {
+            case Field::Type::STRING:
+                util::Escape::logfmt(out, f._str._data, f._str._size);
+                return;
+            case Field::Type::BOOL:
+                out << (f._bool ? "true" : "false");
+                return;
+            default:
+                number(out, f);
+            }
+        }
+
+        static void key(std::ostream &out, const char *key)
+        {
+            util::Escape::logfmt(out, key, strlen(key));
+        }
+
+    private:
+        static void number(std::ostream &out, const Field &f)
+        {
+            char tmp[32];
+            int n = 0;
+            if (f._type == Field::Type::INT)
+                n = snprintf(tmp, sizeof(tmp), "%lld", f._int);
+            else if (f._type == Field::Type::UINT)
+                n = snprintf(tmp, sizeof(tmp), "%llu", f._uint);
+            else
+                n = snprintf(tmp, sizeof(tmp), "%.15g", f._double);
+            out.write(tmp, n);
+        }
+    };
+
+    class FieldsFormatItem : public FormatItem
+    {
+    public:
+        // 以 key=value 形式输出全部结构化字段
+        void format(std::ostream &out, const LogMsg &msg) override
+        {
+            bool first = true;
+            for (const auto &f : msg._fields)
+            {
+                if (!first)
+                    out.put(' ');
+                first = false;
+                FieldWriter::key(out, f._key);
+                out.put('=');
+                FieldWriter::logfmt(out, f);
+            }
+        }
+    };
+
+    class MdcFormatItem : public FormatItem
+    {
+    public:
+        // 子规则指定键时只输出该键的取值，否则以 key=value 形式输出全部键值对
+        MdcFormatItem(const std::string &key = "") : _key(key) {}
+        void format(std::ostream &out, const LogMsg &msg) override
+        {
+            if (msg._mdc == nullptr)
+                return;
+            if (!_key.empty())
+            {
+                const MDC::Entry *e = msg._mdc->find(_key.c_str(), _key.size());
+                if (e != nullptr)
+                    out.write(e->_value, e->_size);
+                return;
+            }
+            bool first = true;
+            for (const MDC::Entry *e = msg._mdc->begin(); e < msg._mdc->end(); e++)
+            {
+                if (msg._mdc->shadowed(e))
+                    continue;
+                if (!first)
+                    out.put(' ');
+                first = false;
+                FieldWriter::key(out, e->_key);
+                out.put('=');
+                util::Escape::logfmt(out, e->_value, e->_size);
+            }
+        }
+
+    private:
+        std::string _key;
+    };
+
     class TabFormatItem : public FormatItem
     {
     public:
@@ -128,13 +293,17 @@ namespace logsys
     /*
         %d 日期
         %T 缩进
-        %t 线程ID
+        %t 线程ID（系统线程ID）
+        %N 线程名
+        %S 全局日志序号
+        %X 线程上下文（key=value，%X{key} 只输出指定键的取值）
         %p 日志级别
         %c 日志器名称
         %f 文件名
         %l 行号
-        %m 日志信息
+        %m 日志信息（%m{text}/%m{json} 对消息进行转义）
         %n 换行
+        %F 结构化字段（key=value）
     */
 
     class Formatter
@@ -147,7 +316,9 @@ namespace logsys
             assert(parsePattern());
         }
 
-        void format(std::ostream &out, const LogMsg &msg)
+        virtual ~Formatter() {}
+
+        virtual void format(std::ostream &out, const LogMsg &msg)
         {
             for (auto &item : _items)
             {
@@ -162,11 +333,42 @@ namespace logsys
             return ss.str();
         }
 
+        // 检查格式化规则字符串是否合法，用于运行期加载的配置，避免非法规则导致进程退出
+        static bool check(const std::string &pattern)
+        {
+            std::vector<std::pair<std::string, std::string>> fmt_order;
+            if (split(pattern, fmt_order) == false)
+                return false;
+            for (const auto &it : fmt_order)
+            {
+                if (createItem(it.first, it.second).get() == nullptr)
+                    return false;
+            }
+            return true;
+        }
+
     private:
         bool parsePattern()
         {
-            // 对格式化规则字符串进行解析
             std::vector<std::pair<std::string, std::string>> fmt_order;
+            if (split(_pattern, fmt_order) == false)
+                return false;
+            for (const auto &it : fmt_order)
+            {
+                FormatItem::ptr item = createItem(it.first, it.second);
+                if (item.get() == nullptr)
+                {
+                    std::cout << "无对应的格式化字符：%" << it.first << std::endl;
+                    abort();
+                }
+                _items.push_back(item);
+            }
+            return true;
+        }
+
+        // 对格式化规则字符串进行解析，拆分为（格式化字符，子规则）序列，原始字符串的格式化字符为空
+        static bool split(const std::string &_pattern, std::vector<std::pair<std::string, std::string>> &fmt_order)
+        {
             size_t pos = 0;
             std::string key, val;
             while (pos < _pattern.size())
@@ -223,15 +425,12 @@ namespace logsys
                 key.clear();
                 val.clear();
             }
-            for (const auto &it : fmt_order)
-            {
-                _items.push_back(createItem(it.first, it.second));
-            }
             return true;
         }
 
     private:
-        FormatItem::ptr createItem(const std::string &key, const std::string &val)
+        // 创建格式化字符对应的格式化子项，不存在对应的格式化字符时返回空
+        static FormatItem::ptr createItem(const std::string &key, const std::string &val)
         {
             if (key == "d")
             {
@@ -263,18 +462,32 @@ namespace logsys
             }
             if (key == "m")
             {
-                return std::make_shared<MsgFormatItem>();
+                return std::make_shared<MsgFormatItem>(val);
             }
             if (key == "n")
             {
                 return std::make_shared<NlineFormatItem>();
             }
+            if (key == "F")
+            {
+                return std::make_shared<FieldsFormatItem>();
+            }
+            if (key == "S")
+            {
+                return std::make_shared<SeqFormatItem>();
+            }
+            if (key == "N")
+            {
+                return std::make_shared<ThreadNameFormatItem>();
+            }
+            if (key == "X")
+            {
+                return std::make_shared<MdcFormatItem>(val);
+            }
             if (key == "")
             {
                 return std::make_shared<OtherFormatItem>(val);
             }
-            std::cout << "无对应的格式化字符：%" << key << std::endl;
-            abort();
             return FormatItem::ptr();
         }
 
@@ -282,6 +495,276 @@ namespace logsys
         std::string _pattern; // 格式化字符串
         std::vector<FormatItem::ptr> _items;
     };
+
+    // JSON格式化器：每条日志输出为一行JSON对象，结构化字段平铺在对象中
+    class JsonFormatter : public Formatter
+    {
+    public:
+        JsonFormatter(const std::string &time_fmt = "%Y-%m-%d %H:%M:%S")
+            : Formatter(""), _time_fmt(time_fmt) {}
+
+        using Formatter::format;
+        void format(std::ostream &out, const LogMsg &msg) override
+        {
+            struct tm t;
+            localtime_r(&msg._ctime, &t);
+            char tmp[64] = {0};
+            size_t n = strftime(tmp, sizeof(tmp) - 1, _time_fmt.c_str(), &t);
+            out << "{\"time\":\"";
+            util::Escape::json(out, tmp, n);
+            out << "\",\"level\":\"" << LogLevel::toString(msg._level);
+            out << "\",\"logger\":\"";
+            util::Escape::json(out, msg._logger.data(), msg._logger.size());
+            out << "\",\"file\":\"";
+            util::Escape::json(out, msg._file.data(), msg._file.size());
+            out << "\",\"line\":" << msg._line;
+            out << ",\"seq\":" << msg._seq;
+            out << ",\"tid\":" << msg._tid;
+            out << ",\"thread\":\"";
+            util::Escape::json(out, msg._thread_name.data(), msg._thread_name.size());
+            out << "\",\"msg\":\"";
+            util::Escape::json(out, msg._payload.data(), msg._payload.size());
+            out.put('"');
+            for (const auto &f : msg._fields)
+            {
+                out << ",\"";
+                util::Escape::json(out, f._key, strlen(f._key));
+                out << "\":";
+                FieldWriter::json(out, f);
+            }
+            if (msg._mdc != nullptr)
+            {
+                for (const MDC::Entry *e = msg._mdc->begin(); e < msg._mdc->end(); e++)
+                {
+                    if (msg._mdc->shadowed(e))
+                        continue;
+                    out << ",\"";
+                    util::Escape::json(out, e->_key, strlen(e->_key));
+                    out << "\":\"";
+                    util::Escape::json(out, e->_value, e->_size);
+                    out.put('"');
+                }
+            }
+            out << "}\n";
+        }
+
+    private:
+        std::string _time_fmt;
+    };
+
+    // logfmt格式化器：每条日志输出为一行 key=value 序列
+    class LogfmtFormatter : public Formatter
+    {
+    public:
+        LogfmtFormatter(const std::string &time_fmt = "%Y-%m-%dT%H:%M:%S")
+            : Formatter(""), _time_fmt(time_fmt) {}
+
+        using Formatter::format;
+        void format(std::ostream &out, const LogMsg &msg) override
+        {
+            struct tm t;
+            localtime_r(&msg._ctime, &t);
+            char tmp[64] = {0};
+            size_t n = strftime(tmp, sizeof(tmp) - 1, _time_fmt.c_str(), &t);
+            out << "time=";
+            util::Escape::logfmt(out, tmp, n);
+            out << " level=" << LogLevel::toString(msg._level);
+            out << " logger=";
+            util::Escape::logfmt(out, msg._logger.data(), msg._logger.size());
+            out << " file=";
+            util::Escape::logfmt(out, msg._file.data(), msg._file.size());
+            out << " line=" << msg._line;
+            out << " seq=" << msg._seq;
+            out << " tid=" << msg._tid;
+            out << " thread=";
+            util::Escape::logfmt(out, msg._thread_name.data(), msg._thread_name.size());
+            out << " msg=";
+            util::Escape::logfmt(out, msg._payload.data(), msg._payload.size());
+            for (const auto &f : msg._fields)
+            {
+                out.put(' ');
+                FieldWriter::key(out, f._key);
+                out.put('=');
+                FieldWriter::logfmt(out, f);
+            }
+            if (msg._mdc != nullptr)
+            {
+                out.put(' ');
+                MdcFormatItem().format(out, msg);
+            }
+            out.put('\n');
+        }
+
+    private:
+        std::string _time_fmt;
+    };
+
+    // 颜色格式化器：按日志等级为被包装格式化器的输出添加ANSI颜色
+    class ColorFormatter : public Formatter
+    {
+    public:
+        ColorFormatter(const Formatter::ptr &formatter)
+            : Formatter(""), _formatter(formatter) {}
+
+        using Formatter::format;
+        void format(std::ostream &out, const LogMsg &msg) override
+        {
+            out << color(msg._level);
+            _formatter->format(out, msg);
+            out << "\033[0m";
+        }
+
+    private:
+        static const char *color(LogLevel::value level)
+        {
+            switch (level)
+            {
+            case LogLevel::value::DEBUG:
+                return "\033[36m"; // 青色
+            case LogLevel::value::INFO:
+                return "\033[32m"; // 绿色
+            case LogLevel::value::WARN:
+                return "\033[33m"; // 黄色
+            case LogLevel::value::ERROR:
+                return "\033[31m"; // 红色
+            case LogLevel::value::FATAL:
+                return "\033[1;31m"; // 加粗红色
+            default:
+                return "\033[0m";
+            }
+        }
+
+    private:
+        Formatter::ptr _formatter;
+    };
+
+#define SYSLOG_PARAM_NAME_MAX 32
+
+    // RFC5424 syslog格式化器：<PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID STRUCTURED-DATA MSG
+    // 日志器名作为MSGID，结构化字段作为SD-ELEMENT，消息主体转义换行后以换行结尾
+    class SyslogFormatter : public Formatter
+    {
+    public:
+        SyslogFormatter(const std::string &app_name = "", int facility = 1)
+            : Formatter(""), _app_name(app_name), _facility(facility), _pid(getpid())
+        {
+            char host[256] = {0};
+            gethostname(host, sizeof(host) - 1);
+            _hostname = host[0] ? host : "-";
+            if (_app_name.empty())
+                _app_name = program_invocation_short_name;
+        }
+
+        using Formatter::format;
+        void format(std::ostream &out, const LogMsg &msg) override
+        {
+            char tmp[64];
+            int n = snprintf(tmp, sizeof(tmp), "<%d>1 ", _facility * 8 + severity(msg._level));
+            out.write(tmp, n);
+            struct tm t;
+            localtime_r(&msg._ctime, &t);
+            n = strftime(tmp, sizeof(tmp), "%Y-%m-%dT%H:%M:%S", &t);
+            out.write(tmp, n);
+            long off = t.tm_gmtoff;
+            n = snprintf(tmp, sizeof(tmp), "%c%02ld:%02ld ", off < 0 ? '-' : '+', labs(off) / 3600, labs(off) % 3600 / 60);
+            out.write(tmp, n);
+            out << _hostname << ' ' << _app_name << ' ' << _pid << ' ' << msg._logger << ' ';
+            if (msg._fields.empty() && msg._mdc == nullptr)
+            {
+                out.put('-');
+            }
+            else
+            {
+                // 结构化字段与线程上下文一并作为SD-PARAM输出
+                out << "[fields@32473";
+                for (const auto &f : msg._fields)
+                {
+                    out.put(' ');
+                    sdName(out, f._key);
+                    out << "=\"";
+                    if (f._type == Field::Type::STRING)
+                        sdValue(out, f._str._data, f._str._size);
+                    else
+                        FieldWriter::logfmt(out, f);
+                    out.put('"');
+                }
+                if (msg._mdc != nullptr)
+                {
+                    for (const MDC::Entry *e = msg._mdc->begin(); e < msg._mdc->end(); e++)
+                    {
+                        if (msg._mdc->shadowed(e))
+                            continue;
+                        out.put(' ');
+                        sdName(out, e->_key);
+                        out << "=\"";
+                        sdValue(out, e->_value, e->_size);
+                        out.put('"');
+                    }
+                }
+                out.put(']');
+            }
+            out.put(' ');
+            util::Escape::text(out, msg._payload.data(), msg._payload.size());
+            out.put('\n');
+        }
+
+    private:
+        static int severity(LogLevel::value level)
+        {
+            switch (level)
+            {
+            case LogLevel::value::DEBUG:
+                return 7;
+            case LogLevel::value::INFO:
+                return 6;
+            case LogLevel::value::WARN:
+                return 4;
+            case LogLevel::value::ERROR:
+                return 3;
+            case LogLevel::value::FATAL:
+                return 2;
+            default:
+                return 5;
+            }
+        }
+
+        // PARAM-NAME 只能由可打印ASCII字符组成，不含 = ] " 与空格，最长32个字符，
+        // 不符合要求的字符替换为 _，超出的部分截断，空的键名输出为 _
+        static void sdName(std::ostream &out, const char *key)
+        {
+            size_t i = 0;
+            for (; key[i] != '\0' && i < SYSLOG_PARAM_NAME_MAX; i++)
+            {
+                unsigned char c = key[i];
+                if (c <= 0x20 || c >= 0x7f || c == '=' || c == ']' || c == '"')
+                    out.put('_');
+                else
+                    out.put(c);
+            }
+            if (i == 0)
+                out.put('_');
+        }
+
+        // SD-PARAM 取值中的 " \ ] 需要转义，换行等控制字符同样转义以保证一行一条
+        static void sdValue(std::ostream &out, const char *data, size_t len)
+        {
+            for (size_t i = 0; i < len; i++)
+            {
+                if (data[i] == '"' || data[i] == '\\' || data[i] == ']')
+                    out.put('\\');
+                if ((unsigned char)data[i] < 0x20)
+                    util::Escape::text(out, data + i, 1);
+                else
+                    out.put(data[i]);
+            }
+        }
+
+    private:
+        std::string _app_name;
+        std::string _hostname;
+        int _facility;
+        int _pid;
+    };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,176 @@
+/*
+    日志文件的稀疏索引：
+    1. 落地方向开启索引后，在日志文件旁写入同名的 .idx 文件
+    2. 每N条日志或每秒为一个块，索引中记录块在日志文件中的偏移与长度，时间范围，包含的等级与日志器
+    3. 索引项定长，查询时直接 mmap 索引文件，只读取时间，等级与日志器可能匹配的块
+    注意：最后一个块在写满或文件关闭时才写入索引，索引之后的数据需由查询方顺序扫描
+*/
+#ifndef __M_INDEX_H__
+#define __M_INDEX_H__
+
+#include "level.hpp"
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+
+namespace logsys
+{
+#define LOG_INDEX_MAGIC "MLOGIDX1"
+#define LOG_INDEX_SUFFIX ".idx"
+#define LOG_INDEX_BLOCK_RECORDS 1024 // 默认每块的最大日志条数
+#define LOG_INDEX_BLOCK_SECONDS 1    // 每块覆盖的最长时间
+
+    // 单条日志的元信息，由日志器交给需要建立索引的落地方向
+    struct RecordInfo
+    {
+        int64_t _ctime;
+        uint32_t _level;
+        uint32_t _len;    // 格式化后的长度
+        uint64_t _logger; // 日志器名称对应的位，见 IndexBlock::loggerBit
+    };
+
+    // 索引项，写入文件的格式，小端
+    struct IndexBlock
+    {
+        uint64_t _offset; // 块在日志文件中的起始位置
+        uint64_t _length;
+        int64_t _tmin;
+        int64_t _tmax;
+        uint32_t _count;   // 块内日志条数
+        uint32_t _levels;  // 第i位表示块内存在等级值为i的日志
+        uint64_t _loggers; // 块内日志器名称的位图（布隆过滤器），可能误判存在，不会误判不存在
+
+        static uint64_t loggerBit(const char *name, size_t len)
+        {
+            // FNV-1a，写入方与查询方需使用相同的散列
+            uint64_t h = 14695981039346656037ULL;
+            for (size_t i = 0; i < len; i++)
+            {
+                h ^= (unsigned char)name[i];
+                h *= 1099511628211ULL;
+            }
+            return (uint64_t)1 << (h % 64);
+        }
+
+        static uint64_t loggerBit(const std::string &name)
+        {
+            return loggerBit(name.data(), name.size());
+        }
+    };
+
+    struct IndexHeader
+    {
+        char _magic[8];
+        uint32_t _block_records;
+        uint32_t _block_seconds;
+    };
+
+    class IndexWriter
+    {
+    public:
+        IndexWriter(size_t block_records = LOG_INDEX_BLOCK_RECORDS)
+            : _block_records(block_records == 0 ? LOG_INDEX_BLOCK_RECORDS : block_records), _offset(0)
+        {
+            memset(&_block, 0, sizeof(_block));
+        }
+
+        ~IndexWriter()
+        {
+            close();
+        }
+
+        // 为日志文件打开对应的索引文件，data_size 为日志文件当前的大小
+        bool open(const std::string &data_path, uint64_t data_size)
+        {
+            close();
+            std::string path = data_path + LOG_INDEX_SUFFIX;
+            struct stat st;
+            bool fresh = (stat(path.c_str(), &st) != 0 || st.st_size == 0);
+            _ofs.open(path, std::ios::binary | std::ios::app);
+            if (!_ofs.is_open())
+                return false;
+            if (fresh)
+            {
+                IndexHeader head;
+                memcpy(head._magic, LOG_INDEX_MAGIC, sizeof(head._magic));
+                head._block_records = (uint32_t)_block_records;
+                head._block_seconds = LOG_INDEX_BLOCK_SECONDS;
+                _ofs.write((const char *)&head, sizeof(head));
+            }
+            _offset = data_size;
+            return true;
+        }
+
+        // 写入未满的块并关闭索引文件
+        void close()
+        {
+            if (!_ofs.is_open())
+                return;
+            seal();
+            _ofs.close();
+        }
+
+        // 记录一条已写入日志文件的日志
+        void append(const RecordInfo &info)
+        {
+            if (_block._count >= _block_records || (_block._count > 0 && info._ctime - _block._tmin >= LOG_INDEX_BLOCK_SECONDS))
+                seal();
+            if (_block._count == 0)
+            {
+                _block._offset = _offset;
+                _block._tmin = info._ctime;
+                _block._tmax = info._ctime;
+            }
+            _block._count++;
+            _block._tmin = info._ctime < _block._tmin ? info._ctime : _block._tmin;
+            _block._tmax = info._ctime > _block._tmax ? info._ctime : _block._tmax;
+            _block._levels |= (uint32_t)1 << (info._level & 31);
+            _block._loggers |= info._logger;
+            _offset += info._len;
+        }
+
+        // 写入了不带元信息的数据，将其计入当前块，并视为可能包含任意等级与日志器
+        void advance(size_t len)
+        {
+            if (len == 0)
+                return;
+            if (_block._count == 0)
+            {
+                _block._offset = _offset;
+                _block._tmin = _block._tmax = time(nullptr);
+            }
+            _block._count++;
+            _block._levels = ~(uint32_t)0;
+            _block._loggers = ~(uint64_t)0;
+            _offset += len;
+        }
+
+        // 将索引文件中已写入的项交给操作系统
+        void flush()
+        {
+            if (_ofs.is_open())
+                _ofs.flush();
+        }
+
+    private:
+        void seal()
+        {
+            if (_block._count == 0)
+                return;
+            _block._length = _offset - _block._offset;
+            _ofs.write((const char *)&_block, sizeof(_block));
+            memset(&_block, 0, sizeof(_block));
+        }
+
+    private:
+        size_t _block_records;
+        uint64_t _offset; // 日志文件当前的写入位置
+        IndexBlock _block; // 正在累积的块
+        std::ofstream _ofs;
+    };
+}
+
+#endif
@@ -1,11 +1,33 @@
 /*
     1. 定义枚举类，枚举出日志等级
-    2. 提供转换接口：将枚举转换为对应字符串
+    2. 提供转换接口：将枚举与对应字符串互相转换
+    3. 提供编译期最低日志等级，例如 -DLOGSYS_MIN_LEVEL=WARN
 */
 
 #ifndef __M_LEVEL_H__
 #define __M_LEVEL_H__
 
+// 日志等级对应的数值，供预处理阶段比较使用，需与 LogLevel::value 保持一致
+#define LOGSYS_LEVEL_UNKNOW 0
+#define LOGSYS_LEVEL_DEBUG 1
+#define LOGSYS_LEVEL_INFO 2
+#define LOGSYS_LEVEL_WARN 3
+#define LOGSYS_LEVEL_ERROR 4
+#define LOGSYS_LEVEL_FATAL 5
+#define LOGSYS_LEVEL_OFF 6
+
+#define LOGSYS_LEVEL_ID_(level) LOGSYS_LEVEL_##level
+#define LOGSYS_LEVEL_ID(level) LOGSYS_LEVEL_ID_(level)
+
+// 编译期最低日志等级，低于该等级的日志宏展开为空，参数表达式不会被求值
+#ifndef LOGSYS_MIN_LEVEL
+#define LOGSYS_MIN_LEVEL DEBUG
+#endif
+#define LOGSYS_MIN_LEVEL_ID LOGSYS_LEVEL_ID(LOGSYS_MIN_LEVEL)
+
+#include <string>
+#include <strings.h>
+
 namespace logsys
 {
     class LogLevel
@@ -41,6 +63,24 @@ namespace logsys
             }
             return "UNKNOWN";
         }
+
+        // 将字符串（不区分大小写）转换为日志等级，无法识别时返回false
+        static bool fromString(const std::string &str, LogLevel::value &level)
+        {
+            static const LogLevel::value levels[] = {
+                LogLevel::value::UNKNOW, LogLevel::value::DEBUG, LogLevel::value::INFO, LogLevel::value::WARN,
+                LogLevel::value::ERROR, LogLevel::value::FATAL, LogLevel::value::OFF};
+            static const char *names[] = {"UNKNOW", "DEBUG", "INFO", "WARN", "ERROR", "FATAL", "OFF"};
+            for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+            {
+                if (strcasecmp(str.c_str(), names[i]) == 0)
+                {
+                    level = levels[i];
+                    return true;
+                }
+            }
+            return false;
+        }
     };
 }
 
@@ -2,6 +2,9 @@
     日志器模块：
     1. 抽象日志器基类
     2. 派生出不同的子类（同步日志器类 与 异步日志器类）
+    3. 注册至 LoggerManager 的日志器按名称中的 '.' 组成层级（如 db -> db.pool -> db.pool.conn，顶层为 root），
+       未设置的输出等级，格式化器与落地方向继承自最近的已注册祖先，祖先变化时立即推送至子孙日志器，
+       各日志器缓存生效的等级，热路径上的等级判断仍只有一次原子读取
 */
 #ifndef __M_LOGGER_H__
 #define __M_LOGGER_H__
@@ -15,14 +18,41 @@
 #include "format.hpp"
 #include "sink.hpp"
 #include "looper.hpp"
+#include "backtrace.hpp"
+#include "epoch.hpp"
+#include "dedup.hpp"
+#include "callsite.hpp"
+#include "trace.hpp"
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cstdarg>
+#include <cstdint>
+#include <cstring>
 #include <mutex>
 #include <sstream>
 #include <unordered_map>
 
+// 对日志接口的格式化字符串与参数进行编译期检查（成员函数的第一个参数为this）
+#if defined(__GNUC__)
+#define LOGSYS_PRINTF(fmt_idx, arg_idx) __attribute__((format(printf, fmt_idx, arg_idx)))
+#else
+#define LOGSYS_PRINTF(fmt_idx, arg_idx)
+#endif
+
 namespace logsys
 {
+#define LOG_MAX_SINKS 64
+#define LOG_RAW_BATCH_RECORDS 64                      // 异步日志器批量写入时每次加锁写入的最大日志条数
+#define LOG_RAW_BATCH_BYTES (DEFAULT_BUFFER_SIZE / 4) // 异步日志器批量写入时每次加锁写入的最大字节数
+
+    // 已格式化完毕的日志，用于 logRaw 批量接口
+    struct RawRecord
+    {
+        LogLevel::value _level;
+        const char *_data;
+        size_t _len;
+    };
     class Logger
     {
     public:
@@ -31,154 +61,628 @@ namespace logsys
                LogLevel::value level,
                Formatter::ptr &formatter,
                std::vector<LogSink::ptr> &sinks) : _logger_name(logger_name),
-                                                   _limit_level(level),
-                                                   _formatter(formatter),
-                                                   _sinks(sinks.begin(), sinks.end()) {}
+                                                   _limit_level(level == LogLevel::value::UNKNOW ? LogLevel::value::DEBUG : level),
+                                                   _gate_level(_limit_level.load()),
+                                                   _logger_bit(IndexBlock::loggerBit(logger_name)),
+                                                   _pipeline(std::make_shared<Pipeline>(formatter ? formatter : std::make_shared<Formatter>(), sinks, _logger_bit)),
+                                                   _current(_pipeline.get()),
+                                                   _own_level(level),
+                                                   _own_formatter(formatter),
+                                                   _own_sinks(sinks),
+                                                   _parent(nullptr),
+                                                   _generation(0)
+        {
+        }
+        virtual ~Logger() {}
         const std::string &name()
         {
             return _logger_name;
         }
-        // 完成构造日志消息对象过程并进行格式化，得到格式化后的日志消息字符串然后进行落地输出
-        void debug(const std::string &file, size_t line, const std::string &fmt, ...)
+
+        // 判断指定等级的日志是否需要处理（输出，或开启回溯时保存至回溯缓冲区）
+        bool shouldLog(LogLevel::value level) const
         {
-            // 1. 判断当前的日志是否达到了输出等级
-            if (LogLevel::value::DEBUG < _limit_level)
-            {
-                return;
-            }
+            return level >= _gate_level.load(std::memory_order_relaxed);
+        }
+
+        // 运行期调整日志器的输出等级，UNKNOW 表示继承父日志器的等级，继承该等级的子孙日志器随之更新
+        void setLevel(LogLevel::value level)
+        {
+            std::unique_lock<std::mutex> lock(hierarchyMutex());
+            _own_level = level;
+            update();
+        }
+
+        // 生效的输出等级
+        LogLevel::value level() const
+        {
+            return _limit_level.load(std::memory_order_relaxed);
+        }
+
+        // 整体替换格式化器与落地方向，正在输出的日志继续使用旧的管线，之后的日志使用新的管线，不阻塞生产者
+        // 返回前等待正在使用旧管线的生产者离开，不能在落地方向或格式化器中调用
+        // formatter 为空或 sinks 为空时继承父日志器的设置，继承该设置的子孙日志器随之更新
+        void reset(const Formatter::ptr &formatter, const std::vector<LogSink::ptr> &sinks)
+        {
+            std::unique_lock<std::mutex> lock(hierarchyMutex());
+            _own_formatter = formatter;
+            _own_sinks = sinks;
+            update();
+        }
+
+        // 本日志器继承的配置最近一次变化时的层级版本，与 hierarchyGeneration() 比较可知层级中是否有其他变化
+        uint64_t generation() const
+        {
+            return _generation.load(std::memory_order_relaxed);
+        }
+
+        // 层级版本，任一日志器的等级，格式化器，落地方向或层级关系变化时递增
+        static std::atomic<uint64_t> &hierarchyGeneration()
+        {
+            static std::atomic<uint64_t> generation(0);
+            return generation;
+        }
+
+        // 开启回溯：低于输出等级的最近count条日志保存在内存中，到达trigger等级的日志输出前先将其输出
+        void enableBacktrace(size_t count, LogLevel::value trigger = LogLevel::value::ERROR)
+        {
+            std::unique_lock<std::mutex> lock(_level_mutex);
+            _backtrace.enable(count, trigger);
+            updateGate();
+        }
+
+        void disableBacktrace()
+        {
+            std::unique_lock<std::mutex> lock(_level_mutex);
+            _backtrace.disable();
+            updateGate();
+        }
+
+        // 回溯保存的日志条数，未开启时为0
+        size_t backtraceCount()
+        {
+            return _backtrace.count();
+        }
+
+        // 主动输出回溯缓冲区中的日志，输出后缓冲区被清空
+        void dumpBacktrace()
+        {
+            _backtrace.dump([this](const Backtrace::Record &rec)
+                            {
+                Arena::Scope scope;
+                LogMsg msg(rec._level, rec._line, "", _logger_name, rec.payload());
+                msg._ctime = rec._ctime;
+                msg._seq = rec._seq;
+                msg._tid = rec._tid;
+                msg._thread_name = rec.threadName();
+                msg._mdc = nullptr; // 回溯缓冲区不保存线程上下文
+                msg._file = rec.file();
+                output(msg); });
+        }
+
+        // 开启重复日志抑制：同一调用位置的相同消息在 window_ms 内只输出一次，之后输出被抑制的次数
+        void enableDedup(size_t window_ms = LOG_DEDUP_WINDOW_MS, size_t slots = LOG_DEDUP_SLOTS)
+        {
+            // 重新开启时先输出旧表中的汇总
+            drainDuplicates();
+            _dedup.enable(window_ms, slots);
+        }
+
+        // 重复日志抑制的时间窗口，未开启时为0
+        size_t dedupWindow()
+        {
+            return _dedup.window();
+        }
+
+        // 关闭重复日志抑制，尚未输出的汇总立即输出
+        void disableDedup()
+        {
+            _dedup.disable([this](const Dedup::Summary &sum)
+                           { outputDuplicate(sum); });
+        }
+
+        // 将已输出的日志全部交给落地方向并刷新落地方向的缓存，超时返回false
+        virtual bool flush(std::chrono::milliseconds timeout = std::chrono::milliseconds(LOG_FLUSH_TIMEOUT_MS)) = 0;
+
+        // 当前线程所在队列最近一条日志的序号（含其他线程写入的日志），是当前线程已输出日志序号的上界，
+        // 在同一线程中配合 waitWritten 等待此前的日志落地，同步日志器的日志在调用返回时即已落地
+        virtual uint64_t sequence() { return 0; }
+
+        // 等待当前线程所在队列中序号不大于seq的日志全部落地，超时返回false
+        virtual bool waitWritten(uint64_t, std::chrono::milliseconds = std::chrono::milliseconds(LOG_FLUSH_TIMEOUT_MS))
+        {
+            return true;
+        }
+
+        // 各等级日志接口，统一交由 logv 完成构造日志消息对象，格式化以及落地输出
+        void debug(const char *file, size_t line, const char *fmt, ...) LOGSYS_PRINTF(4, 5)
+        {
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::DEBUG>(nullptr, file, line, nullptr, fmt, ap);
+            va_end(ap);
+        }
 
-            // 2. 对fmt格式化字符串和不定参进行字符串组织，得到的日志消息的字符串
+        void info(const char *file, size_t line, const char *fmt, ...) LOGSYS_PRINTF(4, 5)
+        {
             va_list ap;
             va_start(ap, fmt);
-            char *res;
-            int ret = vasprintf(&res, fmt.c_str(), ap);
-            if (ret == -1)
-            {
-                std::cout << "vasprintf failed!\n";
-                return;
-            }
+            logv<LogLevel::value::INFO>(nullptr, file, line, nullptr, fmt, ap);
             va_end(ap);
+        }
 
-            serialize(LogLevel::value::DEBUG, file, line, res);
-            free(res);
+        void warn(const char *file, size_t line, const char *fmt, ...) LOGSYS_PRINTF(4, 5)
+        {
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::WARN>(nullptr, file, line, nullptr, fmt, ap);
+            va_end(ap);
         }
 
-        void info(const std::string &file, size_t line, const std::string &fmt, ...)
+        void error(const char *file, size_t line, const char *fmt, ...) LOGSYS_PRINTF(4, 5)
         {
-            // 1. 判断当前的日志是否达到了输出等级
-            if (LogLevel::value::INFO < _limit_level)
-            {
-                return;
-            }
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::ERROR>(nullptr, file, line, nullptr, fmt, ap);
+            va_end(ap);
+        }
 
-            // 2. 对fmt格式化字符串和不定参进行字符串组织，得到的日志消息的字符串
+        void fatal(const char *file, size_t line, const char *fmt, ...) LOGSYS_PRINTF(4, 5)
+        {
             va_list ap;
             va_start(ap, fmt);
-            char *res;
-            int ret = vasprintf(&res, fmt.c_str(), ap);
-            if (ret == -1)
-            {
-                std::cout << "vasprintf failed!\n";
-                return;
-            }
+            logv<LogLevel::value::FATAL>(nullptr, file, line, nullptr, fmt, ap);
             va_end(ap);
+        }
 
-            serialize(LogLevel::value::INFO, file, line, res);
-            free(res);
+        // 携带结构化字段的日志接口，字段随日志消息一起交给格式化器输出
+        void debug(const char *file, size_t line, const Fields &fields, const char *fmt, ...) LOGSYS_PRINTF(5, 6)
+        {
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::DEBUG>(nullptr, file, line, &fields, fmt, ap);
+            va_end(ap);
         }
 
-        void warn(const std::string &file, size_t line, const std::string &fmt, ...)
+        void info(const char *file, size_t line, const Fields &fields, const char *fmt, ...) LOGSYS_PRINTF(5, 6)
         {
-            // 1. 判断当前的日志是否达到了输出等级
-            if (LogLevel::value::WARN < _limit_level)
-            {
-                return;
-            }
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::INFO>(nullptr, file, line, &fields, fmt, ap);
+            va_end(ap);
+        }
 
-            // 2. 对fmt格式化字符串和不定参进行字符串组织，得到的日志消息的字符串
+        void warn(const char *file, size_t line, const Fields &fields, const char *fmt, ...) LOGSYS_PRINTF(5, 6)
+        {
             va_list ap;
             va_start(ap, fmt);
-            char *res;
-            int ret = vasprintf(&res, fmt.c_str(), ap);
-            if (ret == -1)
-            {
-                std::cout << "vasprintf failed!\n";
-                return;
-            }
+            logv<LogLevel::value::WARN>(nullptr, file, line, &fields, fmt, ap);
             va_end(ap);
+        }
 
-            serialize(LogLevel::value::WARN, file, line, res);
-            free(res);
+        void error(const char *file, size_t line, const Fields &fields, const char *fmt, ...) LOGSYS_PRINTF(5, 6)
+        {
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::ERROR>(nullptr, file, line, &fields, fmt, ap);
+            va_end(ap);
         }
 
-        void error(const std::string &file, size_t line, const std::string &fmt, ...)
+        void fatal(const char *file, size_t line, const Fields &fields, const char *fmt, ...) LOGSYS_PRINTF(5, 6)
         {
-            // 1. 判断当前的日志是否达到了输出等级
-            if (LogLevel::value::ERROR < _limit_level)
-            {
-                return;
-            }
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::FATAL>(nullptr, file, line, &fields, fmt, ap);
+            va_end(ap);
+        }
 
-            // 2. 对fmt格式化字符串和不定参进行字符串组织，得到的日志消息的字符串
+        // 日志宏使用的接口，调用位置由宏中的静态 CallSite 给出，同时统计该位置的输出量
+        void debug(CallSite &site, const char *fmt, ...) LOGSYS_PRINTF(3, 4)
+        {
             va_list ap;
             va_start(ap, fmt);
-            char *res;
-            int ret = vasprintf(&res, fmt.c_str(), ap);
-            if (ret == -1)
+            logv<LogLevel::value::DEBUG>(&site, site.file(), site.line(), nullptr, fmt, ap);
+            va_end(ap);
+        }
+
+        void info(CallSite &site, const char *fmt, ...) LOGSYS_PRINTF(3, 4)
+        {
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::INFO>(&site, site.file(), site.line(), nullptr, fmt, ap);
+            va_end(ap);
+        }
+
+        void warn(CallSite &site, const char *fmt, ...) LOGSYS_PRINTF(3, 4)
+        {
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::WARN>(&site, site.file(), site.line(), nullptr, fmt, ap);
+            va_end(ap);
+        }
+
+        void error(CallSite &site, const char *fmt, ...) LOGSYS_PRINTF(3, 4)
+        {
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::ERROR>(&site, site.file(), site.line(), nullptr, fmt, ap);
+            va_end(ap);
+        }
+
+        void fatal(CallSite &site, const char *fmt, ...) LOGSYS_PRINTF(3, 4)
+        {
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::FATAL>(&site, site.file(), site.line(), nullptr, fmt, ap);
+            va_end(ap);
+        }
+
+        void debug(CallSite &site, const Fields &fields, const char *fmt, ...) LOGSYS_PRINTF(4, 5)
+        {
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::DEBUG>(&site, site.file(), site.line(), &fields, fmt, ap);
+            va_end(ap);
+        }
+
+        void info(CallSite &site, const Fields &fields, const char *fmt, ...) LOGSYS_PRINTF(4, 5)
+        {
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::INFO>(&site, site.file(), site.line(), &fields, fmt, ap);
+            va_end(ap);
+        }
+
+        void warn(CallSite &site, const Fields &fields, const char *fmt, ...) LOGSYS_PRINTF(4, 5)
+        {
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::WARN>(&site, site.file(), site.line(), &fields, fmt, ap);
+            va_end(ap);
+        }
+
+        void error(CallSite &site, const Fields &fields, const char *fmt, ...) LOGSYS_PRINTF(4, 5)
+        {
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::ERROR>(&site, site.file(), site.line(), &fields, fmt, ap);
+            va_end(ap);
+        }
+
+        void fatal(CallSite &site, const Fields &fields, const char *fmt, ...) LOGSYS_PRINTF(4, 5)
+        {
+            va_list ap;
+            va_start(ap, fmt);
+            logv<LogLevel::value::FATAL>(&site, site.file(), site.line(), &fields, fmt, ap);
+            va_end(ap);
+        }
+
+        // 先判断等级，只有日志需要输出时才调用func，日志宏借此延迟参数的求值
+        template <typename Func>
+        void logIf(LogLevel::value level, Func func)
+        {
+            if (shouldLog(level))
             {
-                std::cout << "vasprintf failed!\n";
-                return;
+                func(*this);
             }
-            va_end(ap);
+        }
+
+        // 编译期被关闭的日志宏展开为对该接口的调用，参数不会被求值
+        void disabled() {}
 
-            serialize(LogLevel::value::ERROR, file, line, res);
-            free(res);
+        // 输出已格式化完毕的日志：不经过格式化器，数据原样交给全部达到输出等级的落地方向
+        // 不进入回溯缓冲区，也不经过重复日志抑制与调用位置统计
+        void logRaw(const char *data, size_t len, LogLevel::value level = LogLevel::value::INFO)
+        {
+            if (level < _limit_level.load(std::memory_order_relaxed))
+                return;
+            if (Trace::capturing())
+                Trace::record(level, nullptr, 0, len);
+            Epoch::Guard guard;
+            Pipeline &pipeline = *_current.load();
+            uint64_t mask = rawMask(pipeline, level);
+            if (mask == 0)
+                return;
+            RecordInfo info = {(int64_t)util::Date::now(), (uint32_t)level, (uint32_t)len, _logger_bit};
+            log(pipeline, data, len, mask, info);
         }
 
-        void fatal(const std::string &file, size_t line, const std::string &fmt, ...)
+        // 批量输出已格式化完毕的日志，整批只加锁一次（异步日志器按批次大小分段加锁）
+        void logRaw(const RawRecord *records, size_t count)
         {
-            // 1. 判断当前的日志是否达到了输出等级
-            if (LogLevel::value::FATAL < _limit_level)
+            if (count == 0)
+                return;
+            if (Trace::capturing())
+            {
+                LogLevel::value limit = _limit_level.load(std::memory_order_relaxed);
+                for (size_t i = 0; i < count; i++)
+                {
+                    if (records[i]._level >= limit)
+                        Trace::record(records[i]._level, nullptr, 0, records[i]._len);
+                }
+            }
+            Epoch::Guard guard;
+            logBatch(*_current.load(), records, count);
+        }
+
+    protected:
+        template <LogLevel::value Level>
+        void logv(CallSite *site, const char *file, size_t line, const Fields *fields, const char *fmt, va_list ap)
+        {
+            // 1. 判断当前的日志是否达到了输出等级，低于编译期最低等级的判断在编译期即可确定
+            if ((int)Level < LOGSYS_MIN_LEVEL_ID || !shouldLog(Level))
             {
                 return;
             }
 
-            // 2. 对fmt格式化字符串和不定参进行字符串组织，得到的日志消息的字符串
-            va_list ap;
-            va_start(ap, fmt);
-            char *res;
-            int ret = vasprintf(&res, fmt.c_str(), ap);
-            if (ret == -1)
+            // 2. 对fmt格式化字符串和不定参进行字符串组织，直接在线程局部内存池中得到日志消息的字符串
+            Arena::Scope scope;
+            StrRef res;
+            if (scope.arena().vprintf(res, fmt, ap) == false)
             {
-                std::cout << "vasprintf failed!\n";
+                std::cout << "vsnprintf failed!\n";
                 return;
             }
-            va_end(ap);
+            // 低于输出等级的日志只在开启回溯时才会到达此处，保存至回溯缓冲区
+            if (Level < _limit_level.load(std::memory_order_relaxed))
+            {
+                _backtrace.push(Level, file, line, res);
+                return;
+            }
+            // 被抑制的重复日志不输出，也不触发回溯
+            if (_dedup.enabled() && !_dedup.admit(Level, file, line, res, [this](const Dedup::Summary &sum)
+                                                  { outputDuplicate(sum); }))
+            {
+                if (site != nullptr)
+                    site->drop();
+                return;
+            }
+            if (_backtrace.triggered(Level))
+                dumpBacktrace();
+            if (Trace::capturing())
+                Trace::record(Level, file, line, res.size());
+            if (site == nullptr)
+            {
+                serialize(Level, file, line, res, fields);
+                return;
+            }
+            site->record(res.size());
+            CallSite::Scope current(site);
+            serialize(Level, file, line, res, fields);
+        }
 
-            serialize(LogLevel::value::FATAL, file, line, res);
-            free(res);
+        // 输出被抑制的重复日志的汇总，使用原日志的等级与调用位置
+        void outputDuplicate(const Dedup::Summary &sum)
+        {
+            char buf[LOG_DEDUP_TEXT_SIZE + 64];
+            int n = snprintf(buf, sizeof(buf), "重复 %llu 次: %.*s", (unsigned long long)sum._count, (int)sum._len, sum._text);
+            if (n < 0)
+                return;
+            serialize(sum._level, sum._file, sum._line, StrRef(buf, n < (int)sizeof(buf) ? n : sizeof(buf) - 1));
         }
 
-    protected:
-        void serialize(LogLevel::value level, const std::string &file, size_t line, char *str)
+        // 刷新前输出尚未输出的重复日志汇总
+        void drainDuplicates()
+        {
+            if (_dedup.enabled())
+                _dedup.drain([this](const Dedup::Summary &sum)
+                             { outputDuplicate(sum); });
+        }
+
+        void serialize(LogLevel::value level, const char *file, size_t line, const StrRef &str, const Fields *fields = nullptr)
         {
             // 3. 构造LogMsg对象
-            LogMsg msg(level, line, file, _logger_name, str);
+            LogMsg msg(level, line, file, _logger_name, str, fields);
+            output(msg);
+        }
 
-            // 4. 通过格式化工具对LogMsg进行格式化，得到格式化后的日志字符串
-            std::stringstream ss;
-            _formatter->format(ss, msg);
-            // 5. 进行日志落地
-            log(ss.str().c_str(), ss.str().size());
+        void output(const LogMsg &msg)
+        {
+            Arena &arena = Arena::local();
+            LogLevel::value level = msg._level;
+            // 取得当前管线，离开作用域前管线不会被释放，异步日志器的管线在队列中的日志落地前不会被释放
+            Epoch::Guard guard;
+            Pipeline &pipeline = *_current.load();
+            for (auto &group : pipeline._groups)
+            {
+                // 4. 筛选出组内达到输出等级的落地方向，都未达到则不对该组进行格式化
+                uint64_t mask = 0;
+                for (size_t idx : group._sinks)
+                {
+                    if (pipeline._sinks[idx]->shouldLog(level))
+                        mask |= (uint64_t)1 << idx;
+                }
+                if (mask == 0)
+                    continue;
+
+                // 5. 通过格式化工具将LogMsg格式化至内存池上的输出流，同组的落地方向共享格式化的结果
+                ArenaStream::Holder os(arena);
+                group._formatter->format(*os, msg);
+                // 6. 进行日志落地，附带供建立索引使用的元信息
+                RecordInfo info = {(int64_t)msg._ctime, (uint32_t)level, (uint32_t)os->size(), _logger_bit};
+                log(pipeline, os->data(), os->size(), mask, info);
+            }
+        }
+
+    protected:
+        friend class AsyncBackend;
+        friend class LoggerManager;
+
+        struct SinkGroup
+        {
+            Formatter::ptr _formatter;
+            std::vector<size_t> _sinks; // 组内落地方向在 _sinks 中的下标
+        };
+
+        // 输出管线：格式化器，落地方向以及按格式化器的分组，热更新时整体替换
+        struct Pipeline
+        {
+            using ptr = std::shared_ptr<Pipeline>;
+            Pipeline(const Formatter::ptr &formatter, const std::vector<LogSink::ptr> &sinks, uint64_t logger_bit)
+                : _formatter(formatter), _sinks(sinks), _records(0), _logger_bit(logger_bit), _pending(0)
+            {
+                assert(_sinks.size() <= LOG_MAX_SINKS);
+                buildGroups();
+                for (size_t i = 0; i < _sinks.size(); i++)
+                {
+                    if (_sinks[i]->wantsRecords())
+                        _records |= (uint64_t)1 << i;
+                }
+            }
+
+            // 按格式化器对落地方向进行分组，未设置专属格式化器的落地方向使用日志器的格式化器
+            void buildGroups()
+            {
+                // 需要着色的落地方向使用包装后的格式化器，同一格式化器只包装一次
+                std::vector<std::pair<Formatter::ptr, Formatter::ptr>> colored;
+                for (size_t i = 0; i < _sinks.size(); i++)
+                {
+                    Formatter::ptr formatter = _sinks[i]->formatter() ? _sinks[i]->formatter() : _formatter;
+                    if (_sinks[i]->colored())
+                    {
+                        size_t c = 0;
+                        while (c < colored.size() && colored[c].first != formatter)
+                            c++;
+                        if (c == colored.size())
+                            colored.push_back(std::make_pair(formatter, std::make_shared<ColorFormatter>(formatter)));
+                        formatter = colored[c].second;
+                    }
+                    size_t g = 0;
+                    for (; g < _groups.size(); g++)
+                    {
+                        if (_groups[g]._formatter == formatter)
+                            break;
+                    }
+                    if (g == _groups.size())
+                    {
+                        _groups.push_back(SinkGroup());
+                        _groups[g]._formatter = formatter;
+                    }
+                    _groups[g]._sinks.push_back(i);
+                }
+            }
+
+            Formatter::ptr _formatter;
+            std::vector<LogSink::ptr> _sinks;
+            std::vector<SinkGroup> _groups;
+            uint64_t _records;            // 需要逐条日志元信息的落地方向
+            uint64_t _logger_bit;         // 所属日志器名称在索引中对应的位
+            std::atomic<size_t> _pending; // 异步队列中引用该管线但尚未落地的日志数量
+        };
+
+        // 将格式化后的日志交给管线中 mask 对应下标的落地方向，调用者处于 Epoch::Guard 的作用域内
+        virtual void log(Pipeline &pipeline, const char *data, size_t len, uint64_t mask, const RecordInfo &info) = 0;
+        // 将一批已格式化的日志交给管线，各条日志按自身等级选择落地方向
+        virtual void logBatch(Pipeline &pipeline, const RawRecord *records, size_t count) = 0;
+        // 管线被替换且已没有生产者在使用，同步日志器直接释放旧管线
+        virtual void retire(const Pipeline::ptr &) {}
+
+        // 已格式化的日志不区分格式化器分组，所有达到输出等级的落地方向都输出
+        uint64_t rawMask(const Pipeline &pipeline, LogLevel::value level) const
+        {
+            if (level < _limit_level.load(std::memory_order_relaxed))
+                return 0;
+            uint64_t mask = 0;
+            for (size_t i = 0; i < pipeline._sinks.size(); i++)
+            {
+                if (pipeline._sinks[i]->shouldLog(level))
+                    mask |= (uint64_t)1 << i;
+            }
+            return mask;
+        }
+
+    private:
+        // 开启回溯时所有等级的日志都需要处理，否则只处理达到输出等级的日志
+        void updateGate()
+        {
+            LogLevel::value gate = _backtrace.enabled() ? LogLevel::value::UNKNOW : _limit_level.load(std::memory_order_relaxed);
+            _gate_level.store(gate, std::memory_order_relaxed);
+        }
+
+        // 保护层级关系与各日志器自身的设置，层级变化很少，全部日志器共用一把锁
+        static std::mutex &hierarchyMutex()
+        {
+            static std::mutex mutex;
+            return mutex;
+        }
+
+        // 挂到新的父日志器下并重新解析继承的配置，parent 为空时脱离层级，保留当前生效的配置（需持有层级锁）
+        void link(Logger *parent)
+        {
+            if (_parent != nullptr)
+            {
+                std::vector<Logger *> &siblings = _parent->_children;
+                siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+            }
+            _parent = parent;
+            if (_parent != nullptr)
+                _parent->_children.push_back(this);
+            update();
+        }
+
+        // 自身或父日志器的配置变化后更新自身与子孙日志器，等待仍在使用旧管线的生产者离开后统一回收（需持有层级锁）
+        void update()
+        {
+            std::vector<std::pair<Logger *, Pipeline::ptr>> retired;
+            refresh(++hierarchyGeneration(), retired);
+            if (retired.empty())
+                return;
+            Epoch::synchronize();
+            for (auto &item : retired)
+                item.first->retire(item.second);
+        }
+
+        // 按自身设置与父日志器重新计算生效的等级，格式化器与落地方向，有变化时继续更新子日志器（需持有层级锁）
+        // 没有父日志器时未设置的项保留当前生效的配置
+        void refresh(uint64_t generation, std::vector<std::pair<Logger *, Pipeline::ptr>> &retired)
+        {
+            Pipeline::ptr current = _pipeline;
+            Pipeline::ptr inherited = _parent != nullptr ? _parent->_pipeline : current;
+            LogLevel::value level = _own_level;
+            if (level == LogLevel::value::UNKNOW)
+                level = _parent != nullptr ? _parent->level() : this->level();
+            const Formatter::ptr &formatter = _own_formatter ? _own_formatter : inherited->_formatter;
+            const std::vector<LogSink::ptr> &sinks = _own_sinks.empty() ? inherited->_sinks : _own_sinks;
+
+            bool changed = false;
+            if (level != this->level())
+            {
+                std::unique_lock<std::mutex> lock(_level_mutex);
+                _limit_level.store(level, std::memory_order_relaxed);
+                updateGate();
+                changed = true;
+            }
+            if (formatter != current->_formatter || sinks != current->_sinks)
+            {
+                _pipeline = std::make_shared<Pipeline>(formatter, sinks, _logger_bit);
+                _current.store(_pipeline.get());
+                retired.push_back(std::make_pair(this, current));
+                changed = true;
+            }
+            if (changed == false)
+                return;
+            _generation.store(generation, std::memory_order_relaxed);
+            for (Logger *child : _children)
+                child->refresh(generation, retired);
         }
-        virtual void log(const char *data, size_t len) = 0;
 
     protected:
-        std::mutex _mutex;
         std::string _logger_name;
-        std::atomic<LogLevel::value> _limit_level;
-        Formatter::ptr _formatter;
-        std::vector<LogSink::ptr> _sinks;
+        std::atomic<LogLevel::value> _limit_level; // 输出等级
+        std::atomic<LogLevel::value> _gate_level;  // 需要处理的最低等级
+        uint64_t _logger_bit;                      // 日志器名称在索引中对应的位
+        std::mutex _level_mutex;
+        Backtrace _backtrace;
+        Dedup _dedup;
+        Pipeline::ptr _pipeline;            // 持有当前管线，由层级锁保护
+        std::atomic<Pipeline *> _current; // 生产者在 Epoch::Guard 的作用域内读取的当前管线
+        // 以下由层级锁保护
+        LogLevel::value _own_level;           // 自身设置的输出等级，UNKNOW 表示继承
+        Formatter::ptr _own_formatter;        // 为空表示继承
+        std::vector<LogSink::ptr> _own_sinks; // 为空表示继承
+        Logger *_parent;                      // 最近的已注册祖先
+        std::vector<Logger *> _children;
+        std::atomic<uint64_t> _generation;
     };
 
     class SyncLogger : public Logger
@@ -189,45 +693,366 @@ namespace logsys
                    Formatter::ptr &formatter,
                    std::vector<LogSink::ptr> &sinks) : Logger(logger_name, level, formatter, sinks) {}
 
+        // 同步日志器不需要等待，忽略超时时间
+        bool flush(std::chrono::milliseconds = std::chrono::milliseconds(LOG_FLUSH_TIMEOUT_MS))
+        {
+            drainDuplicates();
+            Epoch::Guard guard;
+            Pipeline &pipeline = *_current.load();
+            for (auto &sink : pipeline._sinks)
+            {
+                std::unique_lock<std::mutex> lock(sink->writeMutex());
+                sink->flush();
+            }
+            return true;
+        }
+
     protected:
-        void log(const char *data, size_t len)
+        // 按落地方向加锁，共用同一落地方向的日志器（如父子日志器）之间互斥
+        void log(Pipeline &pipeline, const char *data, size_t len, uint64_t mask, const RecordInfo &info)
         {
-            std::unique_lock<std::mutex> lock(_mutex);
-            if (_sinks.empty())
-                return;
-            for (auto &sink : _sinks)
+            const std::vector<LogSink::ptr> &sinks = pipeline._sinks;
+            for (size_t i = 0; i < sinks.size(); i++)
             {
-                sink->log(data, len);
+                if ((mask & ((uint64_t)1 << i)) == 0)
+                    continue;
+                std::unique_lock<std::mutex> lock(sinks[i]->writeMutex());
+                if (pipeline._records & ((uint64_t)1 << i))
+                    sinks[i]->logRecords(data, len, &info, 1);
+                else
+                    sinks[i]->log(data, len);
+            }
+        }
+
+        // 每个落地方向整批只加锁一次
+        void logBatch(Pipeline &pipeline, const RawRecord *records, size_t count)
+        {
+            int64_t now = util::Date::now();
+            const std::vector<LogSink::ptr> &sinks = pipeline._sinks;
+            LogLevel::value limit = _limit_level.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < sinks.size(); i++)
+            {
+                std::unique_lock<std::mutex> lock(sinks[i]->writeMutex());
+                for (size_t r = 0; r < count; r++)
+                {
+                    const RawRecord &rec = records[r];
+                    if (rec._level < limit || !sinks[i]->shouldLog(rec._level))
+                        continue;
+                    if (pipeline._records & ((uint64_t)1 << i))
+                    {
+                        RecordInfo info = {now, (uint32_t)rec._level, (uint32_t)rec._len, _logger_bit};
+                        sinks[i]->logRecords(rec._data, rec._len, &info, 1);
+                    }
+                    else
+                    {
+                        sinks[i]->log(rec._data, rec._len);
+                    }
+                }
             }
         }
     };
 
+    // 异步日志器的后端：队列，工作线程，落地时拼接日志的缓冲区以及等待释放的旧管线
+    // 每个异步日志器默认独占一个后端，大量日志器可共用一个后端，使线程数与内存随日志量而不随日志器的数量增长
+    class AsyncBackend
+    {
+    public:
+        using ptr = std::shared_ptr<AsyncBackend>;
+        using Pipeline = Logger::Pipeline;
+
+        // 队列中每条日志的头部，记录所属管线与目标落地方向，掩码为0表示刷新标记
+        struct FrameHead
+        {
+            Pipeline *_pipeline;
+            uint64_t _mask;
+            int64_t _ctime;
+            uint32_t _len;
+            uint32_t _level;
+        };
+
+        // 每个CPU分组一个队列与一个绑定在该分组上的工作线程，未分组时使用一个不绑定CPU的队列
+        AsyncBackend(AsyncType looper_type = AsyncType::ASYNC_SAFE,
+                     const std::vector<std::vector<int>> &cpu_groups = std::vector<std::vector<int>>(),
+                     WaitStrategy strategy = WaitStrategy::BLOCK,
+                     const BufferMemory &memory = BufferMemory())
+        {
+            size_t count = cpu_groups.empty() ? 1 : cpu_groups.size();
+            _infos.resize(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                // 指定了缓冲区内存的申请方式时，拼接缓冲区在构建时按一批日志的大小申请，否则在落地时按需增长
+                _scratch.emplace_back(new Buffer(memory.isDefault() ? 0 : DEFAULT_BUFFER_SIZE, memory));
+                std::vector<int> cpus = cpu_groups.empty() ? std::vector<int>() : cpu_groups[i];
+                for (int cpu : cpus)
+                {
+                    if (cpu < 0)
+                        continue;
+                    if ((size_t)cpu >= _shard_of_cpu.size())
+                        _shard_of_cpu.resize(cpu + 1, 0);
+                    _shard_of_cpu[cpu] = i;
+                }
+                _loopers.push_back(std::make_shared<AsyncLooper>(std::bind(&AsyncBackend::realLog, this, std::placeholders::_1, i),
+                                                                 looper_type, DEFAULT_BUFFER_SIZE, cpus, strategy, memory));
+            }
+        }
+
+        // 进程内共用的后端：一个不绑定CPU的队列，缓冲区按需增长，首次使用时创建
+        static const ptr &shared()
+        {
+            static ptr backend = std::make_shared<AsyncBackend>();
+            return backend;
+        }
+
+        size_t shards() const { return _loopers.size(); }
+
+        // 当前线程所在CPU对应的队列
+        size_t shard() const
+        {
+            if (_loopers.size() == 1)
+                return 0;
+            int cpu = util::Topology::currentCpu();
+            if (cpu < 0 || (size_t)cpu >= _shard_of_cpu.size())
+                return 0;
+            return _shard_of_cpu[cpu];
+        }
+
+        const AsyncLooper::ptr &looper(size_t shard) const { return _loopers[shard]; }
+
+        // 被替换或所属日志器已销毁的管线保留至队列中引用它的日志全部落地
+        void retire(const Pipeline::ptr &pipeline)
+        {
+            std::unique_lock<std::mutex> lock(_retire_mutex);
+            _retired.push_back(pipeline);
+        }
+
+    private:
+        void realLog(Buffer &buf, size_t shard)
+        {
+            // 同一批次中连续属于同一管线的日志一起处理
+            const char *ptr = buf.begin();
+            const char *end = ptr + buf.readAbleSize();
+            while (ptr < end)
+            {
+                FrameHead head;
+                memcpy(&head, ptr, sizeof(head));
+                Pipeline *pipeline = head._pipeline;
+                const char *run = ptr;
+                size_t count = 0;
+                bool flush = false;
+                while (ptr < end)
+                {
+                    memcpy(&head, ptr, sizeof(head));
+                    if (head._pipeline != pipeline)
+                        break;
+                    flush |= (head._mask == 0);
+                    ptr += sizeof(head) + head._len;
+                    count++;
+                }
+                deliver(*pipeline, run, ptr, *_scratch[shard], _infos[shard]);
+                if (flush)
+                {
+                    for (auto &sink : pipeline->_sinks)
+                    {
+                        std::unique_lock<std::mutex> lock(sink->writeMutex());
+                        sink->flush();
+                    }
+                }
+                pipeline->_pending.fetch_sub(count, std::memory_order_release);
+            }
+            reclaim();
+        }
+
+        // 按落地方向逐个挑选出属于它的日志，拼接后一次性交给落地方向，保证每个落地方向每批只落地一次
+        // 落地时持有落地方向的写入锁：多个队列的工作线程，以及共用该落地方向的其他日志器之间互斥
+        void deliver(Pipeline &pipeline, const char *begin, const char *end, Buffer &scratch, std::vector<RecordInfo> &infos)
+        {
+            for (size_t i = 0; i < pipeline._sinks.size(); i++)
+            {
+                bool records = pipeline._records & ((uint64_t)1 << i);
+                scratch.reset();
+                infos.clear();
+                const char *ptr = begin;
+                while (ptr < end)
+                {
+                    FrameHead head;
+                    memcpy(&head, ptr, sizeof(head));
+                    ptr += sizeof(head);
+                    if (head._mask & ((uint64_t)1 << i))
+                    {
+                        scratch.push(ptr, head._len);
+                        if (records)
+                        {
+                            RecordInfo info = {head._ctime, head._level, head._len, pipeline._logger_bit};
+                            infos.push_back(info);
+                        }
+                    }
+                    ptr += head._len;
+                }
+                if (scratch.empty())
+                    continue;
+                std::unique_lock<std::mutex> lock(pipeline._sinks[i]->writeMutex());
+                if (records)
+                    pipeline._sinks[i]->logRecords(scratch.begin(), scratch.readAbleSize(), &infos[0], infos.size());
+                else
+                    pipeline._sinks[i]->log(scratch.begin(), scratch.readAbleSize());
+            }
+        }
+
+        // 释放不再被生产者持有且队列中已无日志引用的旧管线
+        void reclaim()
+        {
+            std::unique_lock<std::mutex> lock(_retire_mutex);
+            for (size_t i = 0; i < _retired.size();)
+            {
+                // 管线在生产者全部离开后才被交给后端，之后不会再有新的日志引用它，use_count 为1说明也没有其他持有者
+                if (_retired[i].use_count() == 1 && _retired[i]->_pending.load(std::memory_order_acquire) == 0)
+                {
+                    _retired[i] = _retired.back();
+                    _retired.pop_back();
+                    continue;
+                }
+                i++;
+            }
+        }
+
+    private:
+        std::mutex _retire_mutex;
+        std::vector<Pipeline::ptr> _retired;           // 已被替换但可能仍被队列中日志引用的管线
+        std::vector<size_t> _shard_of_cpu;             // CPU编号到队列下标的映射
+        std::vector<std::unique_ptr<Buffer>> _scratch; // 每个工作线程拼接单个落地方向日志的缓冲区
+        std::vector<std::vector<RecordInfo>> _infos;   // 每个工作线程拼接的日志对应的元信息
+        std::vector<AsyncLooper::ptr> _loopers;        // 放在最后，析构时最先停止工作线程
+    };
+
     class AsyncLogger : public Logger
     {
     public:
+        using FrameHead = AsyncBackend::FrameHead;
+
+        // 独占一个按参数创建的后端
         AsyncLogger(const std::string &logger_name,
                     LogLevel::value level,
                     Formatter::ptr &formatter,
                     std::vector<LogSink::ptr> &sinks,
-                    AsyncType looper_type) : Logger(logger_name, level, formatter, sinks), _looper(std::make_shared<AsyncLooper>(std::bind(&AsyncLogger::realLog, this, std::placeholders::_1), looper_type)) {}
+                    AsyncType looper_type,
+                    const std::vector<std::vector<int>> &cpu_groups = std::vector<std::vector<int>>(),
+                    WaitStrategy strategy = WaitStrategy::BLOCK,
+                    const BufferMemory &memory = BufferMemory())
+            : AsyncLogger(logger_name, level, formatter, sinks,
+                          std::make_shared<AsyncBackend>(looper_type, cpu_groups, strategy, memory))
+        {
+        }
 
-        void log(const char *data, size_t len)
+        // 使用指定的后端，可与其他日志器共用
+        AsyncLogger(const std::string &logger_name,
+                    LogLevel::value level,
+                    Formatter::ptr &formatter,
+                    std::vector<LogSink::ptr> &sinks,
+                    const AsyncBackend::ptr &backend)
+            : Logger(logger_name, level, formatter, sinks), _backend(backend)
         {
-            _looper->push(data, len);
         }
 
-        void realLog(Buffer &buf)
+        // 队列中尚未落地的日志由后端继续处理，当前管线交给后端在其全部落地后释放
+        ~AsyncLogger()
         {
-            if (_sinks.empty())
-                return;
-            for (auto &sink : _sinks)
+            _backend->retire(_pipeline);
+        }
+
+        // 每条日志前附加记录了所属管线与目标落地方向的头部，管线在日志落地前不会被释放
+        // 日志写入当前线程所在CPU对应的队列，减少跨节点的缓存行与内存访问
+        void log(Pipeline &pipeline, const char *data, size_t len, uint64_t mask, const RecordInfo &info)
+        {
+            pipeline._pending.fetch_add(1, std::memory_order_relaxed);
+            FrameHead head = {&pipeline, mask, info._ctime, (uint32_t)len, info._level};
+            _backend->looper(_backend->shard())->push((const char *)&head, sizeof(head), data, len);
+        }
+        // 每段最多 LOG_RAW_BATCH_RECORDS 条日志，头部与数据通过一次加锁写入队列
+        void logBatch(Pipeline &pipeline, const RawRecord *records, size_t count)
+        {
+            int64_t now = util::Date::now();
+            const AsyncLooper::ptr &looper = _backend->looper(_backend->shard());
+            FrameHead heads[LOG_RAW_BATCH_RECORDS];
+            struct iovec iov[LOG_RAW_BATCH_RECORDS * 2];
+            size_t r = 0;
+            while (r < count)
             {
-                sink->log(buf.begin(), buf.readAbleSize());
+                size_t n = 0, bytes = 0;
+                for (; r < count && n < LOG_RAW_BATCH_RECORDS; r++)
+                {
+                    const RawRecord &rec = records[r];
+                    uint64_t mask = rawMask(pipeline, rec._level);
+                    if (mask == 0)
+                        continue;
+                    if (n > 0 && bytes + sizeof(FrameHead) + rec._len > LOG_RAW_BATCH_BYTES)
+                        break;
+                    FrameHead head = {&pipeline, mask, now, (uint32_t)rec._len, (uint32_t)rec._level};
+                    heads[n] = head;
+                    iov[n * 2].iov_base = &heads[n];
+                    iov[n * 2].iov_len = sizeof(FrameHead);
+                    iov[n * 2 + 1].iov_base = (void *)rec._data;
+                    iov[n * 2 + 1].iov_len = rec._len;
+                    bytes += sizeof(FrameHead) + rec._len;
+                    n++;
+                }
+                if (n == 0)
+                    continue;
+                pipeline._pending.fetch_add(n, std::memory_order_relaxed);
+                looper->push(iov, n * 2);
             }
         }
 
+        // 向每个队列写入不指向任何落地方向的刷新标记，工作线程处理到该标记时刷新落地方向
+        bool flush(std::chrono::milliseconds timeout = std::chrono::milliseconds(LOG_FLUSH_TIMEOUT_MS))
+        {
+            drainDuplicates();
+            std::vector<uint64_t> seqs(_backend->shards());
+            {
+                // 等待落地时不处于作用域内，避免阻塞管线的替换
+                Epoch::Guard guard;
+                Pipeline &pipeline = *_current.load();
+                for (size_t i = 0; i < seqs.size(); i++)
+                {
+                    pipeline._pending.fetch_add(1, std::memory_order_relaxed);
+                    FrameHead head = {&pipeline, 0, 0, 0, 0};
+                    seqs[i] = _backend->looper(i)->push((const char *)&head, sizeof(head), nullptr, 0);
+                }
+            }
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            bool ret = true;
+            for (size_t i = 0; i < seqs.size(); i++)
+            {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+                if (left.count() < 0)
+                    left = std::chrono::milliseconds(0);
+                ret = _backend->looper(i)->waitWritten(seqs[i], left) && ret;
+            }
+            return ret;
+        }
+
+        // 多队列时序号只对当前线程所在CPU对应的队列有效，调用线程应在 sequence 与 waitWritten 之间保持在同一CPU分组
+        uint64_t sequence()
+        {
+            return _backend->looper(_backend->shard())->pushed();
+        }
+
+        bool waitWritten(uint64_t seq, std::chrono::milliseconds timeout = std::chrono::milliseconds(LOG_FLUSH_TIMEOUT_MS))
+        {
+            return _backend->looper(_backend->shard())->waitWritten(seq, timeout);
+        }
+
+        size_t shards() const { return _backend->shards(); }
+
+        const AsyncBackend::ptr &backend() const { return _backend; }
+
+        // 被替换的管线保留至队列中引用它的日志全部落地
+        void retire(const Pipeline::ptr &pipeline)
+        {
+            _backend->retire(pipeline);
+        }
+
     private:
-        AsyncLooper::ptr _looper;
+        AsyncBackend::ptr _backend;
     };
 
     enum class LoggerType
@@ -243,8 +1068,13 @@ namespace logsys
     {
     public:
         LoggerBuilder() : _logger_type(LoggerType::LOGGER_SYNC),
-                          _limit_level(LogLevel::value::DEBUG),
-                          _looper_type(AsyncType::ASYNC_SAFE)
+                          _limit_level(LogLevel::value::UNKNOW),
+                          _looper_type(AsyncType::ASYNC_SAFE),
+                          _backtrace_count(0),
+                          _backtrace_trigger(LogLevel::value::ERROR),
+                          _wait_strategy(WaitStrategy::BLOCK),
+                          _dedup_window(0),
+                          _dedup_slots(LOG_DEDUP_SLOTS)
         {
         }
         void buildLoggerType(LoggerType type)
@@ -257,26 +1087,109 @@ namespace logsys
             _looper_type = AsyncType::ASUNC_UNSAFE;
         }
 
+        // 异步日志器工作线程等待日志的方式
+        void buildWaitStrategy(WaitStrategy strategy)
+        {
+            _wait_strategy = strategy;
+        }
+
+        // 异步日志器使用指定的后端（默认为进程内共用的后端），与其他日志器共用队列与工作线程
+        // 此时异步日志器的缓冲区类型，等待方式，CPU分组与缓冲区内存由后端决定，不再单独设置
+        void buildSharedBackend(const AsyncBackend::ptr &backend = AsyncBackend::shared())
+        {
+            _backend = backend;
+        }
+
+        // 异步日志器缓冲区内存使用的页面类型，lock 为true时锁定在内存中，缓冲区在构建日志器时即申请并写入完毕
+        void buildBufferMemory(PageType pages, bool lock = false)
+        {
+            _buffer_memory = BufferMemory(pages, lock);
+        }
+
+        // 异步日志器按CPU分组建立多个队列，每组的工作线程绑定在组内CPU上，线程写入所在CPU对应的队列
+        void buildAsyncGroups(const std::vector<std::vector<int>> &groups)
+        {
+            _cpu_groups = groups;
+        }
+
+        // 每个NUMA节点一个队列
+        void buildAsyncPerNode()
+        {
+            _cpu_groups = util::Topology::nodes();
+        }
+
+        // 单个队列，工作线程绑定在指定的CPU上
+        void buildAsyncCpus(const std::vector<int> &cpus)
+        {
+            _cpu_groups.assign(1, cpus);
+        }
+
         void buildLoggerName(const std::string &name)
         {
             _logger_name = name;
         }
 
+        // 未设置时继承父日志器的等级，不在层级中的日志器为 DEBUG
         void buildLoggerLevel(LogLevel::value level)
         {
             _limit_level = level;
         }
 
+        // 开启回溯，低于输出等级的最近count条日志在到达trigger等级的日志输出前输出
+        void buildBacktrace(size_t count, LogLevel::value trigger = LogLevel::value::ERROR)
+        {
+            _backtrace_count = count;
+            _backtrace_trigger = trigger;
+        }
+
+        // 开启重复日志抑制，window_ms 为0时不开启
+        void buildDedup(size_t window_ms = LOG_DEDUP_WINDOW_MS, size_t slots = LOG_DEDUP_SLOTS)
+        {
+            _dedup_window = window_ms;
+            _dedup_slots = slots;
+        }
+
         void buildFormmatter(const std::string &pattern)
         {
             _formatter = std::make_shared<Formatter>(pattern);
         }
 
+        // 使用已创建的格式化器
+        void buildFormmatter(const Formatter::ptr &formatter)
+        {
+            _formatter = formatter;
+        }
+
+        // 使用指定类型的格式化器，如 JsonFormatter/LogfmtFormatter
+        template <typename FormatterType, typename... Args>
+        void buildFormmatter(Args &&...args)
+        {
+            _formatter = std::make_shared<FormatterType>(std::forward<Args>(args)...);
+        }
+
+        // 创建带独立队列与工作线程的落地方向，队列已满时按 policy 处理
         template <typename SinkType, typename... Args>
-        void buildSink(Args &&...args)
+        LogSink::ptr buildAsyncSink(OverflowPolicy policy, Args &&...args)
+        {
+            LogSink::ptr psink = SinkFactory::create<SinkType>(std::forward<Args>(args)...);
+            LogSink::ptr pasync = std::make_shared<AsyncSink>(psink, policy);
+            _sinks.push_back(pasync);
+            return pasync;
+        }
+
+        // 返回创建的落地方向，可继续设置其专属的输出等级与格式化器
+        template <typename SinkType, typename... Args>
+        LogSink::ptr buildSink(Args &&...args)
         {
             LogSink::ptr psink = SinkFactory::create<SinkType>(std::forward<Args>(args)...);
             _sinks.push_back(psink);
+            return psink;
+        }
+
+        // 添加已创建的落地方向
+        void buildSink(const LogSink::ptr &sink)
+        {
+            _sinks.push_back(sink);
         }
 
         virtual Logger::ptr build() = 0;
@@ -288,6 +1201,14 @@ namespace logsys
         std::atomic<LogLevel::value> _limit_level;
         Formatter::ptr _formatter;
         std::vector<LogSink::ptr> _sinks;
+        size_t _backtrace_count;
+        LogLevel::value _backtrace_trigger;
+        std::vector<std::vector<int>> _cpu_groups;
+        WaitStrategy _wait_strategy;
+        BufferMemory _buffer_memory;
+        AsyncBackend::ptr _backend;
+        size_t _dedup_window;
+        size_t _dedup_slots;
     };
 
     class LocalLoggerBuilder : public LoggerBuilder
@@ -304,11 +1225,27 @@ namespace logsys
             {
                 buildSink<StdoutSink>();
             }
+            Logger::ptr logger;
             if (_logger_type == LoggerType::LOGGER_ASYNC)
             {
-                return std::make_shared<AsyncLogger>(_logger_name, _limit_level, _formatter, _sinks, _looper_type);
+                if (_backend)
+                    logger = std::make_shared<AsyncLogger>(_logger_name, _limit_level, _formatter, _sinks, _backend);
+                else
+                    logger = std::make_shared<AsyncLogger>(_logger_name, _limit_level, _formatter, _sinks, _looper_type, _cpu_groups, _wait_strategy, _buffer_memory);
+            }
+            else
+            {
+                logger = std::make_shared<SyncLogger>(_logger_name, _limit_level, _formatter, _sinks);
+            }
+            if (_backtrace_count > 0)
+            {
+                logger->enableBacktrace(_backtrace_count, _backtrace_trigger);
             }
-            return std::make_shared<SyncLogger>(_logger_name, _limit_level, _formatter, _sinks);
+            if (_dedup_window > 0)
+            {
+                logger->enableDedup(_dedup_window, _dedup_slots);
+            }
+            return logger;
         }
     };
 
@@ -323,12 +1260,27 @@ namespace logsys
             return eton;
         }
 
+        // 注册日志器并挂入层级，同名日志器已存在时不注册，只按层级解析其继承的配置
         void addLogger(Logger::ptr &logger)
         {
-            if (hasLogger(logger->name()))
-                return;
             std::unique_lock<std::mutex> lock(_mutex);
+            std::unique_lock<std::mutex> tree(Logger::hierarchyMutex());
+            Logger *parent = findParent(logger->name());
+            if (_loggers.find(logger->name()) != _loggers.end())
+            {
+                logger->link(parent);
+                logger->link(nullptr);
+                return;
+            }
             _loggers.insert(std::make_pair(logger->name(), logger));
+            logger->link(parent);
+            // 原先挂在父日志器下，名称位于新日志器之下的日志器改挂到新日志器下
+            std::vector<Logger *> children = parent->_children;
+            for (Logger *child : children)
+            {
+                if (isDescendant(child->name(), logger->name()))
+                    child->link(logger.get());
+            }
         }
 
         bool hasLogger(const std::string &name)
@@ -352,16 +1304,119 @@ namespace logsys
             }
             return it->second;
         }
-        Logger::ptr rootLogger()
+
+        // 注册日志器，同名日志器已存在时替换，被替换的日志器先刷新其日志，默认日志器不可替换
+        bool replaceLogger(const Logger::ptr &logger)
+        {
+            Logger::ptr old;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (logger->name() == _root_logger->name())
+                    return false;
+                Logger::ptr &slot = _loggers[logger->name()];
+                old = slot;
+                slot = logger;
+                // 新日志器接替旧日志器在层级中的位置
+                std::unique_lock<std::mutex> tree(Logger::hierarchyMutex());
+                Logger *parent = findParent(logger->name());
+                logger->link(parent);
+                std::vector<Logger *> children = old ? old->_children : parent->_children;
+                for (Logger *child : children)
+                {
+                    if (isDescendant(child->name(), logger->name()))
+                        child->link(logger.get());
+                }
+                if (old)
+                    old->link(nullptr);
+            }
+            if (old.get() != nullptr)
+                old->flush();
+            return true;
+        }
+
+        // 移除日志器并刷新其日志，仍持有该日志器的使用者可继续使用（保留移除时生效的配置），默认日志器不可移除
+        // 其子日志器改挂到其父日志器下
+        bool removeLogger(const std::string &name)
+        {
+            Logger::ptr logger;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                auto it = _loggers.find(name);
+                if (it == _loggers.end() || it->second == _root_logger)
+                    return false;
+                logger = it->second;
+                _loggers.erase(it);
+                std::unique_lock<std::mutex> tree(Logger::hierarchyMutex());
+                std::vector<Logger *> children = logger->_children;
+                for (Logger *child : children)
+                    child->link(logger->_parent);
+                logger->link(nullptr);
+            }
+            logger->flush();
+            return true;
+        }
+
+        // 刷新全部日志器，全部在超时时间内完成返回true
+        bool flushAll(std::chrono::milliseconds timeout = std::chrono::milliseconds(LOG_FLUSH_TIMEOUT_MS))
+        {
+            std::vector<Logger::ptr> loggers;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                for (auto &it : _loggers)
+                    loggers.push_back(it.second);
+            }
+            bool ret = true;
+            for (auto &logger : loggers)
+                ret = logger->flush(timeout) && ret;
+            return ret;
+        }
+
+        const Logger::ptr &rootLogger()
         {
             return _root_logger;
         }
 
+        // 层级版本，任一日志器的配置或层级关系变化时递增
+        uint64_t generation() const
+        {
+            return Logger::hierarchyGeneration().load(std::memory_order_relaxed);
+        }
+
     private:
+        // name 是否位于 ancestor 之下，如 db.pool.conn 位于 db 之下
+        static bool isDescendant(const std::string &name, const std::string &ancestor)
+        {
+            return name.size() > ancestor.size() && name[ancestor.size()] == '.' &&
+                   name.compare(0, ancestor.size(), ancestor) == 0;
+        }
+
+        // 最近的已注册祖先，没有时为默认日志器，默认日志器自身没有父日志器（需持有 _mutex）
+        Logger *findParent(const std::string &name)
+        {
+            if (name == _root_logger->name())
+                return nullptr;
+            size_t pos = name.rfind('.');
+            while (pos != std::string::npos && pos > 0)
+            {
+                auto it = _loggers.find(name.substr(0, pos));
+                if (it != _loggers.end())
+                    return it->second.get();
+                pos = name.rfind('.', pos - 1);
+            }
+            return _root_logger.get();
+        }
+
+        // 进程退出时单例析构，先刷新全部日志器，避免尾部日志留在队列或落地方向的缓存中
+        ~LoggerManager()
+        {
+            flushAll();
+        }
+
         LoggerManager()
         {
             std::unique_ptr<logsys::LoggerBuilder> builder(new logsys::LocalLoggerBuilder());
             builder->buildLoggerName("root");
+            builder->buildLoggerLevel(LogLevel::value::DEBUG);
             _root_logger = builder->build();
             _loggers.insert(std::make_pair("root", _root_logger));
         }
@@ -378,24 +1433,28 @@ namespace logsys
         Logger::ptr build() override
         {
             assert(!_logger_name.empty());
-            if (_formatter.get() == nullptr)
-            {
-                _formatter = std::make_shared<Formatter>();
-            }
-            if (_sinks.empty())
-            {
-                buildSink<StdoutSink>();
-            }
+            // 未设置的格式化器与落地方向在注册时继承自父日志器
             Logger::ptr logger;
             if (_logger_type == LoggerType::LOGGER_ASYNC)
             {
 
-                logger = std::make_shared<AsyncLogger>(_logger_name, _limit_level, _formatter, _sinks, _looper_type);
+                if (_backend)
+                    logger = std::make_shared<AsyncLogger>(_logger_name, _limit_level, _formatter, _sinks, _backend);
+                else
+                    logger = std::make_shared<AsyncLogger>(_logger_name, _limit_level, _formatter, _sinks, _looper_type, _cpu_groups, _wait_strategy, _buffer_memory);
             }
             else
             {
                 logger = std::make_shared<SyncLogger>(_logger_name, _limit_level, _formatter, _sinks);
             }
+            if (_backtrace_count > 0)
+            {
+                logger->enableBacktrace(_backtrace_count, _backtrace_trigger);
+            }
+            if (_dedup_window > 0)
+            {
+                logger->enableDedup(_dedup_window, _dedup_slots);
+            }
             LoggerManager::getInstance().addLogger(logger);
             return logger;
         }
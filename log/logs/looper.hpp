@@ -2,31 +2,87 @@
 #define __M_LOOPER_H__
 
 #include "buffer.hpp"
+#include "topology.hpp"
+#include <chrono>
+#include <cstdint>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 #include <functional>
 #include <memory>
+#include <sys/uio.h>
 
 namespace logsys
 {
+#define LOG_FLUSH_TIMEOUT_MS 5000     // 刷新日志时默认的最长等待时间
+#define LOOPER_SPIN_COUNT 2000        // 自适应等待时休眠前的自旋次数
+#define LOOPER_YIELD_COUNT 50         // 自旋之后休眠之前让出CPU的次数
+#define LOOPER_BATCH_INTERVAL_US 1000 // 定时批量处理的间隔
+#define LOOPER_INIT_BUFFER_SIZE (64 * 1024) // 按需增长的缓冲区的初始大小
+#define LOOPER_SHRINK_INTERVAL_MS 1000      // 按需增长的缓冲区每隔该时间按期间的最大批次缩小，空闲该时间后恢复初始大小
     using Functor = std::function<void(Buffer &)>;
     enum class AsyncType
     {
         ASYNC_SAFE,  // 安全状态，表示缓冲区满了则阻塞，避免资源耗尽的风险
         ASUNC_UNSAFE // 不考虑资源耗尽的问题，无限扩容，常用于测试
     };
+
+    // 工作线程等待数据的方式，生产者只在工作线程休眠时才唤醒它
+    enum class WaitStrategy
+    {
+        BLOCK,       // 没有数据时立即休眠
+        ADAPTIVE,    // 先自旋，再让出CPU，仍无数据时休眠，适合日志间隔较短的场景
+        BUSY_POLL,   // 一直自旋不休眠，延迟最低，需独占一个CPU
+        TIMED_BATCH  // 每隔固定间隔或缓冲区数据过半时处理一批，减少唤醒次数，延迟最高
+    };
+
+    // 自旋等待时降低CPU功耗并让出流水线
+    inline void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
     class AsyncLooper
     {
     public:
         using ptr = std::shared_ptr<AsyncLooper>;
-        AsyncLooper(const Functor &cb, AsyncType loop_type = AsyncType::ASYNC_SAFE)
-            : _looper_type(loop_type),
+        // cpus 非空时工作线程绑定至这些CPU，并由工作线程申请缓冲区，使缓冲区内存分配在其所在的NUMA节点上
+        // memory 指定缓冲区内存的页面类型与是否锁定，缓冲区在构造完成前申请并写入完毕
+        // 使用默认内存时缓冲区从较小的初始大小开始，按需增长至 buffer_size，空闲时缩小
+        AsyncLooper(const Functor &cb, AsyncType loop_type = AsyncType::ASYNC_SAFE, size_t buffer_size = DEFAULT_BUFFER_SIZE,
+                    const std::vector<int> &cpus = std::vector<int>(), WaitStrategy strategy = WaitStrategy::BLOCK,
+                    const BufferMemory &memory = BufferMemory())
+            : _callBack(cb),
+              _looper_type(loop_type),
+              _strategy(strategy),
               _stop(false),
-              _thread(std::thread(&AsyncLooper::threadEntry, this)),
-              _callBack(cb)
+              _pushed(0),
+              _written(0),
+              _taken(0),
+              _flush_seq(0),
+              _sleeping(false),
+              _batching(false),
+              _buffer_size(buffer_size),
+              _init_size(memory.isDefault() && buffer_size > LOOPER_INIT_BUFFER_SIZE ? LOOPER_INIT_BUFFER_SIZE : buffer_size),
+              _peak(0),
+              _trim(0),
+              _target(buffer_size),
+              _check_at(std::chrono::steady_clock::now() + std::chrono::milliseconds(LOOPER_SHRINK_INTERVAL_MS)),
+              _cpus(cpus),
+              _memory(memory),
+              _ready(cpus.empty()),
+              _pro_buf(cpus.empty() ? _init_size : 0, memory),
+              _con_buf(cpus.empty() ? _init_size : 0, memory),
+              _thread(std::thread(&AsyncLooper::threadEntry, this))
         {
+            // 等待工作线程完成缓冲区的申请
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond_pro.wait(lock, [&]()
+                           { return _ready; });
         }
 
         ~AsyncLooper()
@@ -36,50 +92,276 @@ namespace logsys
 
         void stop()
         {
-            _stop = true;           // 修改退出标志为true
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _stop = true; // 修改退出标志为true
+            }
             _cond_con.notify_all(); // 唤醒所有工作线程
-            _thread.join();         // 等待工作线程退出
+            if (_thread.joinable())
+                _thread.join(); // 等待工作线程退出
         }
 
-        void push(const char *data, size_t len)
+        // 写入数据，返回本次写入的序号，可用于 waitWritten 等待其处理完毕
+        uint64_t push(const char *data, size_t len)
         {
             std::unique_lock<std::mutex> lock(_mutex);
             // 条件变量空值，若缓冲区剩余空间大小大于数据长度，则添加数据
-            if (_looper_type == AsyncType::ASYNC_SAFE)
-                _cond_pro.wait(lock, [&]()
-                               { return _pro_buf.writeAbleSize() >= len; });
+            waitSpace(lock, len);
             // 能够走下来代表满足了条件，可以向缓冲区添加数据
             _pro_buf.push(data, len);
             // 唤醒消费者对缓冲区中的数据进行处理
-            _cond_con.notify_one();
+            wakeConsumer();
+            return _pushed.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+
+        // 非阻塞写入，安全模式下缓冲区剩余空间不足时直接返回false
+        bool tryPush(const char *data, size_t len)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_looper_type == AsyncType::ASYNC_SAFE && !reserve(len))
+                return false;
+            _pro_buf.push(data, len);
+            wakeConsumer();
+            _pushed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // 将头部与数据作为一个整体写入缓冲区，避免与其他生产者交错
+        uint64_t push(const char *head, size_t head_len, const char *data, size_t len)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            waitSpace(lock, head_len + len);
+            _pro_buf.push(head, head_len);
+            if (len > 0)
+                _pro_buf.push(data, len);
+            wakeConsumer();
+            return _pushed.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+
+        // 将多段数据作为一个整体写入缓冲区，只加锁一次，用于批量写入多条日志
+        uint64_t push(const struct iovec *iov, size_t iovcnt)
+        {
+            size_t total = 0;
+            for (size_t i = 0; i < iovcnt; i++)
+                total += iov[i].iov_len;
+            std::unique_lock<std::mutex> lock(_mutex);
+            waitSpace(lock, total);
+            for (size_t i = 0; i < iovcnt; i++)
+            {
+                if (iov[i].iov_len > 0)
+                    _pro_buf.push((const char *)iov[i].iov_base, iov[i].iov_len);
+            }
+            wakeConsumer();
+            return _pushed.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+
+        // 非阻塞地将头部与数据作为一个整体写入缓冲区，安全模式下缓冲区剩余空间不足时直接返回false
+        bool tryPush(const char *head, size_t head_len, const char *data, size_t len)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_looper_type == AsyncType::ASYNC_SAFE && !reserve(head_len + len))
+                return false;
+            _pro_buf.push(head, head_len);
+            if (len > 0)
+                _pro_buf.push(data, len);
+            wakeConsumer();
+            _pushed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // 最近一次写入的序号
+        uint64_t pushed()
+        {
+            return _pushed.load(std::memory_order_relaxed);
+        }
+
+        // 等待序号不大于seq的数据全部处理完毕（回调函数返回），超时返回false
+        bool waitWritten(uint64_t seq, std::chrono::milliseconds timeout)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_written < seq)
+            {
+                // 定时批量处理时要求工作线程立即处理，不等待下一个间隔
+                if (seq > _flush_seq)
+                    _flush_seq = seq;
+                if (_sleeping || _batching)
+                    _cond_con.notify_one();
+            }
+            return _cond_done.wait_for(lock, timeout, [&]()
+                                       { return _written >= seq; });
+        }
+
+        // 等待目前已写入的数据全部处理完毕
+        bool flush(std::chrono::milliseconds timeout)
+        {
+            return waitWritten(pushed(), timeout);
         }
 
     private:
+        // 安全模式下等待生产缓冲区有足够的空间，等待前确保工作线程未在休眠
+        void waitSpace(std::unique_lock<std::mutex> &lock, size_t len)
+        {
+            if (_looper_type != AsyncType::ASYNC_SAFE || reserve(len))
+                return;
+            if (_sleeping || _batching)
+                _cond_con.notify_one();
+            _cond_pro.wait(lock, [&]()
+                           { return reserve(len); });
+        }
+
+        // 持锁调用，生产缓冲区剩余空间不足时在 buffer_size 以内翻倍增长，返回剩余空间是否足够
+        bool reserve(size_t len)
+        {
+            if (_pro_buf.writeAbleSize() >= len)
+                return true;
+            size_t need = _pro_buf.readAbleSize() + len;
+            if (_init_size == _buffer_size || need > _buffer_size)
+                return false;
+            size_t size = _pro_buf.capacity() * 2 > need ? _pro_buf.capacity() * 2 : need;
+            _pro_buf.resize(size < _buffer_size ? size : _buffer_size);
+            return true;
+        }
+
+        // 消费缓冲区处理完毕后调用，每个检查间隔按期间的最大批次缩小随后处理的两个缓冲区
+        void shrink(size_t batch)
+        {
+            if (_init_size == _buffer_size)
+                return;
+            _peak = batch > _peak ? batch : _peak;
+            auto now = std::chrono::steady_clock::now();
+            if (now >= _check_at)
+            {
+                size_t size = _init_size;
+                while (size < _peak * 2)
+                    size <<= 1;
+                _trim = 2;
+                _target = size;
+                _peak = 0;
+                _check_at = now + std::chrono::milliseconds(LOOPER_SHRINK_INTERVAL_MS);
+            }
+            if (_trim > 0)
+            {
+                _trim--;
+                if (_con_buf.capacity() > _target)
+                    _con_buf.resize(_target);
+            }
+        }
+
+        // 持锁调用，工作线程因没有数据而休眠时才唤醒，定时攒批时只在数据过半时提前唤醒
+        void wakeConsumer()
+        {
+            if (_sleeping || (_batching && _pro_buf.readAbleSize() >= _buffer_size / 2))
+                _cond_con.notify_one();
+        }
+
+        // 不持锁等待新数据，返回后由调用者持锁确认
+        void spin()
+        {
+            if (_strategy == WaitStrategy::BUSY_POLL)
+            {
+                while (_pushed.load(std::memory_order_relaxed) == _taken && !_stop)
+                    cpuRelax();
+                return;
+            }
+            if (_strategy != WaitStrategy::ADAPTIVE)
+                return;
+            for (int i = 0; i < LOOPER_SPIN_COUNT; i++)
+            {
+                if (_pushed.load(std::memory_order_relaxed) != _taken || _stop)
+                    return;
+                cpuRelax();
+            }
+            for (int i = 0; i < LOOPER_YIELD_COUNT; i++)
+            {
+                if (_pushed.load(std::memory_order_relaxed) != _taken || _stop)
+                    return;
+                std::this_thread::yield();
+            }
+        }
+
+        // 持锁休眠直至有数据可处理
+        void park(std::unique_lock<std::mutex> &lock)
+        {
+            if (_pro_buf.empty())
+            {
+                _sleeping = true;
+                auto ready = [&]()
+                { return _stop || !_pro_buf.empty(); };
+                if (_pro_buf.capacity() > _init_size || _con_buf.capacity() > _init_size)
+                {
+                    // 空闲一个检查间隔后两个缓冲区恢复初始大小，此时消费缓冲区为空且只由工作线程访问
+                    if (!_cond_con.wait_for(lock, std::chrono::milliseconds(LOOPER_SHRINK_INTERVAL_MS), ready))
+                    {
+                        _pro_buf.resize(_init_size);
+                        _con_buf.resize(_init_size);
+                    }
+                }
+                else
+                {
+                    _cond_con.wait(lock, ready);
+                }
+                _sleeping = false;
+            }
+            if (_strategy == WaitStrategy::TIMED_BATCH && !_stop)
+            {
+                // 有数据后再等待一个间隔攒成一批，数据过半或有等待者时提前处理
+                _batching = true;
+                _cond_con.wait_for(lock, std::chrono::microseconds(LOOPER_BATCH_INTERVAL_US), [&]()
+                                   { return _stop || _flush_seq > _taken || _pro_buf.readAbleSize() >= _buffer_size / 2; });
+                _batching = false;
+            }
+        }
+
         // 线程入口函数，对消费缓冲区中的数据进行处理，处理完毕后，初始化缓冲区并交换缓冲区
         void threadEntry()
         {
+            if (!_cpus.empty())
+            {
+                // 先绑定CPU再申请缓冲区，缓冲区在构造时被写入，按首次访问的原则分配在当前节点
+                util::Topology::bind(_cpus);
+                Buffer pro(_init_size, _memory), con(_init_size, _memory);
+                std::unique_lock<std::mutex> lock(_mutex);
+                _pro_buf.swap(pro);
+                _con_buf.swap(con);
+                _ready = true;
+                _cond_pro.notify_all();
+            }
             while (1)
             {
                 // 1.判断生产缓冲区有无数据，有则交换，无则阻塞
                 // 为互斥锁设置一个生命周期，当缓冲区交换完毕解锁
+                uint64_t seq = 0;
+                spin();
                 {
                     std::unique_lock<std::mutex> lock(_mutex);
                     // 退出标志被设置，且生产缓冲区已无数据，这时候再退出，否则可能会造成生产缓冲区有数据但没有完全处理
                     if (_stop && _pro_buf.empty())
                         break;
                     // 若当前是退出前被唤醒，或者有数据被唤醒，则返回真，继续向下运行，否则重新陷入休眠
-                    _cond_con.wait(lock, [&]()
-                                   { return _stop || !_pro_buf.empty(); });
+                    if (_pro_buf.empty() || _strategy == WaitStrategy::TIMED_BATCH)
+                        park(lock);
+                    if (_pro_buf.empty())
+                        continue;
 
                     _con_buf.swap(_pro_buf);
+                    seq = _pushed.load(std::memory_order_relaxed); // 本批次包含的最大序号
+                    _taken = seq;
                     // 2.唤醒生产者
                     if (_looper_type == AsyncType::ASYNC_SAFE)
                         _cond_pro.notify_all();
                 }
                 // 3.被唤醒后，对消费者缓冲区进行数据处理
                 _callBack(_con_buf);
-                // 4.初始化消费者缓冲区
+                // 4.初始化消费者缓冲区，按需缩小
+                size_t batch = _con_buf.readAbleSize();
                 _con_buf.reset();
+                shrink(batch);
+                // 5.更新已处理的序号，唤醒等待者
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _written = seq;
+                }
+                _cond_done.notify_all();
             }
         }
 
@@ -89,12 +371,29 @@ namespace logsys
         //
     private:
         AsyncType _looper_type;
-        std::atomic<bool> _stop; // 工作器停止标志
-        Buffer _pro_buf;         // 生产缓冲区
-        Buffer _con_buf;         // 消费缓冲区
+        WaitStrategy _strategy;
+        std::atomic<bool> _stop;        // 工作器停止标志
+        std::atomic<uint64_t> _pushed;  // 已写入的数据序号，持锁修改，工作线程自旋时不持锁读取
+        uint64_t _written;              // 已处理完毕的数据序号
+        uint64_t _taken;                // 工作线程已取走的数据序号
+        uint64_t _flush_seq;            // 等待者要求尽快处理的数据序号
+        bool _sleeping;                 // 工作线程因没有数据而休眠
+        bool _batching;                 // 工作线程正在定时攒批
+        size_t _buffer_size;            // 缓冲区最大大小
+        size_t _init_size;              // 缓冲区初始大小，与最大大小相同时不增长也不缩小
+        size_t _peak;                   // 本检查间隔内的最大批次，只由工作线程访问
+        size_t _trim;                   // 还需缩小的缓冲区个数
+        size_t _target;                 // 缩小的目标大小
+        std::chrono::steady_clock::time_point _check_at; // 下一次检查的时间
+        std::vector<int> _cpus;         // 工作线程绑定的CPU
+        BufferMemory _memory;           // 缓冲区内存的申请方式
+        bool _ready;                    // 缓冲区已申请完毕
+        Buffer _pro_buf;                // 生产缓冲区
+        Buffer _con_buf;                // 消费缓冲区
         std::mutex _mutex;
         std::condition_variable _cond_pro;
         std::condition_variable _cond_con;
+        std::condition_variable _cond_done; // 数据处理完毕
         std::thread _thread; // 异步工作器对应的工作线程
     };
 }
@@ -0,0 +1,111 @@
+/*
+    线程上下文（MDC，Mapped Diagnostic Context）：
+    1. 每个线程一份，以定长数组内联保存键值对（如请求ID，租户），不进行堆内存申请
+    2. 通过 MDC::Scope 在作用域内压入键值对，离开作用域时自动弹出，支持嵌套，同名键以最内层为准
+    3. 日志消息只在需要输出时记录当前线程上下文的指针，格式化器通过 %X / %X{key} 输出
+    注意：键只保存指针（通常为字符串常量），取值被拷贝，过长的取值被截断，超过上限的键值对被忽略
+*/
+#ifndef __M_MDC_H__
+#define __M_MDC_H__
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace logsys
+{
+#define LOG_MDC_SIZE 8
+#define LOG_MDC_VALUE_SIZE 64
+
+    class MDC
+    {
+    public:
+        struct Entry
+        {
+            const char *_key;
+            size_t _size;
+            char _value[LOG_MDC_VALUE_SIZE];
+        };
+
+        // RAII方式压入键值对，作用域结束时弹出
+        class Scope
+        {
+        public:
+            Scope(const char *key, const char *value) { MDC::local().push(key, value, strlen(value)); }
+            Scope(const char *key, const std::string &value) { MDC::local().push(key, value.data(), value.size()); }
+            Scope(const char *key, long long value)
+            {
+                char tmp[32];
+                int n = snprintf(tmp, sizeof(tmp), "%lld", value);
+                MDC::local().push(key, tmp, n);
+            }
+            ~Scope() { MDC::local().pop(); }
+
+        private:
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+        };
+
+        MDC() : _size(0), _depth(0) {}
+
+        static MDC &local()
+        {
+            static thread_local MDC mdc;
+            return mdc;
+        }
+
+        void push(const char *key, const char *value, size_t len)
+        {
+            if (_depth++ >= LOG_MDC_SIZE)
+                return;
+            Entry &e = _items[_size++];
+            e._key = key;
+            e._size = len < LOG_MDC_VALUE_SIZE ? len : LOG_MDC_VALUE_SIZE;
+            memcpy(e._value, value, e._size);
+        }
+
+        void pop()
+        {
+            if (_depth == 0)
+                return;
+            _depth--;
+            if (_depth < _size)
+                _size = _depth;
+        }
+
+        // 查找键对应的条目，同名键返回最内层的条目，不存在返回nullptr
+        const Entry *find(const char *key, size_t len) const
+        {
+            for (size_t i = _size; i > 0; i--)
+            {
+                const Entry &e = _items[i - 1];
+                if (strncmp(e._key, key, len) == 0 && e._key[len] == '\0')
+                    return &e;
+            }
+            return nullptr;
+        }
+
+        // 同名键被内层覆盖时返回true，输出全部键值对时跳过被覆盖的条目
+        bool shadowed(const Entry *entry) const
+        {
+            for (const Entry *e = entry + 1; e < end(); e++)
+            {
+                if (strcmp(e->_key, entry->_key) == 0)
+                    return true;
+            }
+            return false;
+        }
+
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        const Entry *begin() const { return _items; }
+        const Entry *end() const { return _items + _size; }
+
+    private:
+        Entry _items[LOG_MDC_SIZE];
+        size_t _size;  // 已保存的条目数量
+        size_t _depth; // 压入的层数，超过上限的部分未保存但仍需配对弹出
+    };
+}
+
+#endif
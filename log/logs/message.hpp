@@ -4,43 +4,72 @@
     2. 日志等级         用于进行日志过滤分析
     3. 源文件名称
     4. 源文件行号        用于定位出现错误的代码位置
-    5. 线程ID           用于过滤出错的线程
+    5. 线程ID与线程名    用于过滤出错的线程（系统线程ID）
     6. 日志主体消息
     7. 日志器名称       (当前支持多日志器的同时使用)
+    8. 结构化字段       (内联保存的键值对)
+    9. 全局序号         (进程内所有日志器共享的递增序号，用于还原多线程/多文件日志的先后顺序)
+    10. 线程上下文      (输出时当前线程的MDC，只记录指针)
 */
 #ifndef __M_MSG_H_
 #define __M_MSG_H_
 
 #include "level.hpp"
 #include "util.hpp"
+#include "field.hpp"
+#include "arena.hpp"
+#include "mdc.hpp"
 #include <iostream>
 #include <string>
+#include <cstring>
+#include <atomic>
+#include <cstdint>
 #include <thread>
 
 namespace logsys
 {
+    // 获取下一个全局日志序号，从1开始
+    inline uint64_t nextSequence()
+    {
+        static std::atomic<uint64_t> seq(0);
+        return seq.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
     struct LogMsg
     {
         time_t _ctime;
+        uint64_t _seq;
         LogLevel::value _level;
         size_t _line;
-        std::thread::id _tid;
-        std::string _file;
-        std::string _logger;
-        std::string _payload;
+        pid_t _tid;
+        StrRef _thread_name;
+        StrRef _file;
+        StrRef _logger;
+        StrRef _payload;
+        Fields _fields;
+        const MDC *_mdc; // 线程上下文为空时为nullptr
 
+        // 文件名（__FILE__）与日志器名在日志处理期间一直有效，只记录指针，消息主体已由调用者在内存池中完成格式化
         LogMsg(LogLevel::value level,
                size_t line,
-               const std::string &file,
+               const char *file,
                const std::string &logger,
-               const std::string &msg)
+               const StrRef &msg,
+               const Fields *fields = nullptr)
             : _ctime(util::Date::now()),
+              _seq(nextSequence()),
               _level(level),
               _line(line),
-              _tid(std::this_thread::get_id()),
-              _file(file),
-              _logger(logger),
-              _payload(msg) {}
+              _tid(util::Thread::id()),
+              _thread_name(util::Thread::name(), util::Thread::nameSize()),
+              _file(file, strlen(file)),
+              _logger(logger.data(), logger.size()),
+              _payload(msg),
+              _mdc(MDC::local().empty() ? nullptr : &MDC::local())
+        {
+            if (fields != nullptr)
+                _fields = *fields;
+        }
     };
 }
 
@@ -2,33 +2,75 @@
 #define __M_MLOG_H__
 
 #include "logger.hpp"
+#include "socket.hpp"
+#include "config.hpp"
 
 namespace logsys
 {
     // 获取指定日志器全局接口，避免用户自己操作单例对象
-    Logger::ptr getLogger(const std::string &name)
+    inline Logger::ptr getLogger(const std::string &name)
     {
         return logsys::LoggerManager::getInstance().getLogger(name);
     }
 
-    Logger::ptr rootLogger()
+    inline const Logger::ptr &rootLogger()
     {
         return logsys::LoggerManager::getInstance().rootLogger();
     }
 
-// 使用宏函数对日志器的接口进行代理
-#define debug(fmt, ...) debug(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define info(fmt, ...) info(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define warn(fmt, ...) warn(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define error(fmt, ...) error(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-#define fatal(fmt, ...) fatal(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
-
-// 提供宏函数，直接通过默认日志器进行日志的标准输出打印
+// 使用宏函数对日志器的接口进行代理：
+// 1. 低于编译期最低等级(LOGSYS_MIN_LEVEL)的日志展开为空操作
+// 2. 其余日志先判断日志器的当前等级，需要输出时才对参数求值，关闭的日志不会执行参数中的耗时调用
+// 3. 每个调用位置一个静态的 CallSite，统计该位置输出的日志条数与字节数，通过 logsys::CallSite::report() 查看
+#if LOGSYS_LEVEL_DEBUG >= LOGSYS_MIN_LEVEL_ID
+#define debug(fmt, ...) logIf(logsys::LogLevel::value::DEBUG, [&](logsys::Logger &logsys_self_) \
+    { static logsys::CallSite logsys_site_(__FILE__, __LINE__, logsys::LogLevel::value::DEBUG); \
+      logsys_self_.debug(logsys_site_, fmt, ##__VA_ARGS__); })
 #define DEBUG(fmt, ...) logsys::rootLogger()->debug(fmt, ##__VA_ARGS__)
+#else
+#define debug(fmt, ...) disabled()
+#define DEBUG(fmt, ...) ((void)0)
+#endif
+
+#if LOGSYS_LEVEL_INFO >= LOGSYS_MIN_LEVEL_ID
+#define info(fmt, ...) logIf(logsys::LogLevel::value::INFO, [&](logsys::Logger &logsys_self_)  \
+    { static logsys::CallSite logsys_site_(__FILE__, __LINE__, logsys::LogLevel::value::INFO); \
+      logsys_self_.info(logsys_site_, fmt, ##__VA_ARGS__); })
 #define INFO(fmt, ...) logsys::rootLogger()->info(fmt, ##__VA_ARGS__)
+#else
+#define info(fmt, ...) disabled()
+#define INFO(fmt, ...) ((void)0)
+#endif
+
+#if LOGSYS_LEVEL_WARN >= LOGSYS_MIN_LEVEL_ID
+#define warn(fmt, ...) logIf(logsys::LogLevel::value::WARN, [&](logsys::Logger &logsys_self_)  \
+    { static logsys::CallSite logsys_site_(__FILE__, __LINE__, logsys::LogLevel::value::WARN); \
+      logsys_self_.warn(logsys_site_, fmt, ##__VA_ARGS__); })
 #define WARN(fmt, ...) logsys::rootLogger()->warn(fmt, ##__VA_ARGS__)
+#else
+#define warn(fmt, ...) disabled()
+#define WARN(fmt, ...) ((void)0)
+#endif
+
+#if LOGSYS_LEVEL_ERROR >= LOGSYS_MIN_LEVEL_ID
+#define error(fmt, ...) logIf(logsys::LogLevel::value::ERROR, [&](logsys::Logger &logsys_self_) \
+    { static logsys::CallSite logsys_site_(__FILE__, __LINE__, logsys::LogLevel::value::ERROR); \
+      logsys_self_.error(logsys_site_, fmt, ##__VA_ARGS__); })
 #define ERROR(fmt, ...) logsys::rootLogger()->error(fmt, ##__VA_ARGS__)
+#else
+#define error(fmt, ...) disabled()
+#define ERROR(fmt, ...) ((void)0)
+#endif
+
+#if LOGSYS_LEVEL_FATAL >= LOGSYS_MIN_LEVEL_ID
+#define fatal(fmt, ...) logIf(logsys::LogLevel::value::FATAL, [&](logsys::Logger &logsys_self_) \
+    { static logsys::CallSite logsys_site_(__FILE__, __LINE__, logsys::LogLevel::value::FATAL); \
+      logsys_self_.fatal(logsys_site_, fmt, ##__VA_ARGS__); })
 #define FATAL(fmt, ...) logsys::rootLogger()->fatal(fmt, ##__VA_ARGS__)
+#else
+#define fatal(fmt, ...) disabled()
+#define FATAL(fmt, ...) ((void)0)
+#endif
 }
 
 #endif
\ No newline at end of file
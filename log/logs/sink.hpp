@@ -3,14 +3,39 @@
     1. 抽象落地基类
     2. 派生子类（根据不同的落地方向进行派生）
     3. 使用工厂模式进行创建与表示的分离
+    4. 每个落地方向可单独设置最低输出等级与专属的格式化器
+    5. 异步落地方向：为单个落地方向提供独立的有界队列与工作线程，慢速落地方向不会拖慢其他落地方向
+    6. 标准输出/标准错误直接写入文件描述符，不与 iostream 同步
+    7. 文件落地方向可为日志文件建立稀疏索引，供 tools/logquery 按时间，等级与日志器快速查询
+    8. 滚动文件由后台线程提前创建下一个文件并关闭旧文件，切换文件不在输出日志的线程上打开/关闭文件
 */
 #ifndef __M_SINK_H__
 #define __M_SINK_H__
 
 #include "util.hpp"
+#include "level.hpp"
+#include "format.hpp"
+#include "looper.hpp"
+#include "index.hpp"
+#include "callsite.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <memory>
 #include <cassert>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 
 namespace logsys
 {
@@ -18,19 +43,198 @@ namespace logsys
     {
     public:
         using ptr = std::shared_ptr<LogSink>;
-        LogSink() {}
+        LogSink() : _level(LogLevel::value::UNKNOW) {}
         virtual ~LogSink() {}
         virtual void log(const char *data, size_t len) = 0;
+        // 将落地方向内部缓存的数据写出
+        virtual void flush() {}
+        // 是否需要按日志等级为输出添加颜色，由日志器为其包装 ColorFormatter
+        virtual bool colored() const { return false; }
+        // 是否需要逐条日志的元信息（如建立索引），返回true时日志器通过 logRecords 交付日志，构造后不可改变
+        virtual bool wantsRecords() const { return false; }
+        // 一次交付连续存放的count条日志，infos 中依次为每条日志的长度与元信息
+        virtual void logRecords(const char *data, size_t len, const RecordInfo *, size_t)
+        {
+            log(data, len);
+        }
+
+        // 设置落地方向的最低输出等级，低于该等级的日志不会为其格式化与输出
+        void setLevel(LogLevel::value level)
+        {
+            _level = level;
+        }
+
+        LogLevel::value level() const
+        {
+            return _level.load(std::memory_order_relaxed);
+        }
+
+        bool shouldLog(LogLevel::value level) const
+        {
+            return level >= _level.load(std::memory_order_relaxed);
+        }
+
+        // 设置落地方向专属的格式化器，为空时使用日志器的格式化器，需在构建日志器之前设置
+        void setFormatter(const Formatter::ptr &formatter)
+        {
+            _formatter = formatter;
+        }
+
+        const Formatter::ptr &formatter() const
+        {
+            return _formatter;
+        }
+
+        // 写入锁：同一落地方向可被多个日志器共用（如子日志器继承父日志器的落地方向），
+        // 日志器与工作线程持有该锁调用 log/logRecords/flush
+        virtual std::mutex &writeMutex()
+        {
+            return _write_mutex;
+        }
+
+    protected:
+        std::atomic<LogLevel::value> _level;
+        Formatter::ptr _formatter;
+        std::mutex _write_mutex;
     };
 
-    class StdoutSink : public LogSink
+#define FD_SINK_BUFFER_SIZE (64 * 1024)
+    // 落地方向：直接写入文件描述符，不经过 iostream/stdio
+    // 设置了缓冲区大小时小块数据先攒入缓冲区，缓冲区放不下或 flush 时与新数据通过一次 writev 写出
+    class FdSink : public LogSink
     {
     public:
-        // 将日志消息写入至标准输出
+        FdSink(int fd, size_t buffer_size = 0) : _fd(fd), _capacity(buffer_size)
+        {
+            _buffer.reserve(buffer_size);
+        }
+
+        ~FdSink()
+        {
+            flush();
+        }
+
         void log(const char *data, size_t len)
         {
-            std::cout.write(data, len);
+            if (_buffer.size() + len <= _capacity)
+            {
+                _buffer.insert(_buffer.end(), data, data + len);
+                return;
+            }
+            write(data, len);
+        }
+
+        void flush()
+        {
+            write(nullptr, 0);
         }
+
+    protected:
+        // 将缓冲区中的数据与新数据一并写出，处理部分写入与中断
+        void write(const char *data, size_t len)
+        {
+            iovec iov[2];
+            int cnt = 0;
+            if (!_buffer.empty())
+            {
+                iov[cnt].iov_base = &_buffer[0];
+                iov[cnt].iov_len = _buffer.size();
+                cnt++;
+            }
+            if (len > 0)
+            {
+                iov[cnt].iov_base = (void *)data;
+                iov[cnt].iov_len = len;
+                cnt++;
+            }
+            iovec *pos = iov;
+            while (cnt > 0)
+            {
+                ssize_t ret = writev(_fd, pos, cnt);
+                if (ret < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    {
+                        pollfd pfd = {_fd, POLLOUT, 0};
+                        poll(&pfd, 1, -1);
+                        continue;
+                    }
+                    break;
+                }
+                size_t n = ret;
+                while (cnt > 0 && n >= pos->iov_len)
+                {
+                    n -= pos->iov_len;
+                    pos++;
+                    cnt--;
+                }
+                if (cnt > 0)
+                {
+                    pos->iov_base = (char *)pos->iov_base + n;
+                    pos->iov_len -= n;
+                }
+            }
+            _buffer.clear();
+        }
+
+    protected:
+        int _fd;
+        size_t _capacity;
+        std::vector<char> _buffer;
+    };
+
+    // 终端颜色模式
+    enum class ColorMode
+    {
+        AUTO,   // 输出至终端时启用颜色
+        ALWAYS, // 总是启用颜色
+        NEVER   // 不启用颜色
+    };
+
+    // 落地方向：标准输出/标准错误，直接写入文件描述符，输出至终端时按日志等级着色
+    class ConsoleSink : public FdSink
+    {
+    public:
+        ConsoleSink(int fd, ColorMode mode = ColorMode::AUTO, size_t buffer_size = 0)
+            : FdSink(fd, buffer_size), _colored(false)
+        {
+            if (mode == ColorMode::ALWAYS)
+            {
+                _colored = true;
+            }
+            else if (mode == ColorMode::AUTO)
+            {
+                // 遵循 NO_COLOR 约定，哑终端不着色
+                const char *term = getenv("TERM");
+                _colored = isatty(fd) && getenv("NO_COLOR") == nullptr && !(term && strcmp(term, "dumb") == 0);
+            }
+        }
+
+        bool colored() const
+        {
+            return _colored;
+        }
+
+    private:
+        bool _colored;
+    };
+
+    class StdoutSink : public ConsoleSink
+    {
+    public:
+        // 将日志消息写入至标准输出
+        StdoutSink(ColorMode mode = ColorMode::AUTO, size_t buffer_size = 0)
+            : ConsoleSink(STDOUT_FILENO, mode, buffer_size) {}
+    };
+
+    class StderrSink : public ConsoleSink
+    {
+    public:
+        // 将日志消息写入至标准错误
+        StderrSink(ColorMode mode = ColorMode::AUTO, size_t buffer_size = 0)
+            : ConsoleSink(STDERR_FILENO, mode, buffer_size) {}
     };
 
     // 落地方向：指定文件
@@ -38,7 +242,8 @@ namespace logsys
     {
     public:
         // 构造时传入文件名并打开文件，将操作句柄管理起来
-        FileSink(const std::string &pathname)
+        // index_block 非0时建立稀疏索引，每块最多 index_block 条日志
+        FileSink(const std::string &pathname, size_t index_block = 0)
             : _pathname(pathname)
         {
             // 1. 创建日志文件所在的目录
@@ -47,57 +252,285 @@ namespace logsys
             _ofs.open(_pathname, std::ios::binary | std::ios::app);
 
             assert(_ofs.is_open());
+            if (index_block > 0)
+            {
+                _index.reset(new IndexWriter(index_block));
+                _index->open(_pathname, util::File::size(_pathname));
+            }
         }
 
         void log(const char *data, size_t len)
         {
             _ofs.write(data, len);
             assert(_ofs.good());
+            if (_index)
+                _index->advance(len);
+        }
+
+        bool wantsRecords() const
+        {
+            return _index != nullptr;
+        }
+
+        void logRecords(const char *data, size_t len, const RecordInfo *infos, size_t count)
+        {
+            _ofs.write(data, len);
+            assert(_ofs.good());
+            for (size_t i = 0; i < count; i++)
+                _index->append(infos[i]);
+        }
+
+        void flush()
+        {
+            _ofs.flush();
+            if (_index)
+                _index->flush();
         }
 
     private:
         std::string _pathname;
         std::ofstream _ofs;
+        std::unique_ptr<IndexWriter> _index;
     };
 
+#define ROLL_SINK_BUFFER_SIZE FD_SINK_BUFFER_SIZE
     // 落地方向：滚动文件（以大小进行滚动）
-    class RollBySizeSink : public LogSink
+    // 1. 直接写入文件描述符，小块数据先攒入缓冲区
+    // 2. 后台线程提前创建下一个日志文件并预分配空间，切换文件时只需交换文件描述符
+    // 3. 旧文件的关闭，索引的收尾与用户指定的后续处理（如压缩）由后台线程完成
+    class RollBySizeSink : public FdSink
     {
     public:
+        // 切换后对旧文件的后续处理，在后台线程中以旧文件名调用
+        using RollCallback = std::function<void(const std::string &)>;
+
         // 构造时传入文件名，并打开文件，将操作句柄管理起来
-        RollBySizeSink(const std::string &basename, size_t max_size)
-            : _basename(basename),
+        // index_block 非0时为每个日志文件建立稀疏索引，每块最多 index_block 条日志
+        RollBySizeSink(const std::string &basename, size_t max_size, size_t index_block = 0)
+            : FdSink(-1, ROLL_SINK_BUFFER_SIZE),
+              _basename(basename),
+              _name_count(0),
               _max_fsize(max_size),
               _cur_fsize(0),
-              _name_count(0)
+              _index_block(index_block),
+              _stop(false),
+              _next(nullptr),
+              _releasing(0)
         {
-            std::string pathname = createNewFile();
-            // 1. 创建日志文件所在的目录
-            util::File::create_directory(util::File::path(pathname));
-            // 2. 创建并打开日志文件
-            _ofs.open(pathname, std::ios::binary | std::ios::app);
-
-            assert(_ofs.is_open());
+            // 创建日志文件所在的目录
+            util::File::create_directory(util::File::path(basename));
+            Segment *seg = prepare();
+            assert(seg->_fd >= 0);
+            adopt(seg);
+            _thread = std::thread(&RollBySizeSink::threadEntry, this);
         }
 
-        // 将日志消息写入至标准输出，写入前判断文件大小，超过了最大大小要切换文件
-        void log(const char *data, size_t len)
+        ~RollBySizeSink()
         {
-            if (_cur_fsize >= _max_fsize)
+            flush();
             {
-                _ofs.close();
-                std::string pathname = createNewFile();
-                _ofs.open(pathname, std::ios::binary | std::ios::app);
-                assert(_ofs.is_open());
-                _cur_fsize = 0;
+                std::unique_lock<std::mutex> lock(_mutex);
+                _stop = true;
             }
-            _ofs.write(data, len);
-            assert(_ofs.good());
+            _cond.notify_all();
+            _thread.join(); // 后台线程退出前处理完全部待关闭的文件
+            // 当前文件正常关闭，提前创建但未使用的文件删除
+            Segment cur;
+            cur._fd = _fd;
+            cur._index = std::move(_index);
+            release(cur);
+            _fd = -1;
+            if (_next != nullptr)
+            {
+                _next->_index.reset();
+                ::close(_next->_fd);
+                unlink(_next->_pathname.c_str());
+                if (_index_block > 0)
+                    unlink((_next->_pathname + LOG_INDEX_SUFFIX).c_str());
+                delete _next;
+            }
+        }
+
+        // 设置旧文件的后续处理，需在开始输出日志之前设置
+        void setRollCallback(const RollCallback &cb)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _on_roll = cb;
+        }
+
+        // 将日志消息写入文件，写入前判断文件大小，超过了最大大小要切换文件
+        void log(const char *data, size_t len)
+        {
+            roll();
+            FdSink::log(data, len);
             _cur_fsize += len;
+            if (_index)
+                _index->advance(len);
+        }
+
+        bool wantsRecords() const
+        {
+            return _index_block > 0;
+        }
+
+        void logRecords(const char *data, size_t len, const RecordInfo *infos, size_t count)
+        {
+            roll();
+            FdSink::log(data, len);
+            _cur_fsize += len;
+            for (size_t i = 0; i < count; i++)
+                _index->append(infos[i]);
+        }
+
+        // 切换文件后旧文件尚未写出的数据由后台线程写入，刷新时等待其写完
+        void flush()
+        {
+            FdSink::flush();
+            if (_index)
+                _index->flush();
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [&]()
+                       { return _closing.empty() && _releasing == 0; });
         }
 
     private:
-        // 进行大小判断，超过指定大小则创建新的文件
+        // 一个已打开的日志文件及其索引
+        struct Segment
+        {
+            int _fd;
+            std::string _pathname;
+            size_t _size;
+            std::vector<char> _buffer; // 旧文件：尚未写入文件的数据；新文件：预留好空间的空缓冲区
+            std::unique_ptr<IndexWriter> _index;
+        };
+
+        // 当前文件超过最大大小时换上提前创建好的文件，旧文件交给后台线程关闭
+        void roll()
+        {
+            if (_cur_fsize < _max_fsize)
+                return;
+            Segment *next = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                next = _next;
+                _next = nullptr;
+            }
+            // 后台线程尚未准备好时当场创建
+            if (next == nullptr)
+                next = prepare();
+            // 缓冲区中尚未写出的数据随旧文件一起交给后台线程
+            Segment old;
+            old._fd = _fd;
+            old._pathname.swap(_pathname);
+            old._buffer.swap(_buffer);
+            old._index = std::move(_index);
+            adopt(next);
+            assert(_fd >= 0);
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _closing.push_back(std::move(old));
+            }
+            _cond.notify_all();
+        }
+
+        // 创建并打开新的日志文件，预分配空间，需要时打开对应的索引文件
+        Segment *prepare()
+        {
+            Segment *seg = new Segment;
+            seg->_pathname = createNewFile();
+            seg->_fd = ::open(seg->_pathname.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            // 只预留磁盘空间，不改变文件大小，文件系统不支持时忽略
+            if (seg->_fd >= 0 && _max_fsize > 0)
+                fallocate(seg->_fd, FALLOC_FL_KEEP_SIZE, 0, _max_fsize);
+            seg->_size = util::File::size(seg->_pathname);
+            seg->_buffer.reserve(_capacity);
+            if (_index_block > 0)
+            {
+                seg->_index.reset(new IndexWriter(_index_block));
+                seg->_index->open(seg->_pathname, seg->_size);
+            }
+            return seg;
+        }
+
+        void adopt(Segment *seg)
+        {
+            _fd = seg->_fd;
+            _pathname.swap(seg->_pathname);
+            _buffer.swap(seg->_buffer);
+            _index = std::move(seg->_index);
+            _cur_fsize = seg->_size;
+            delete seg;
+        }
+
+        // 写出剩余数据，写完索引并关闭文件，释放文件末尾未使用的预分配空间
+        static void release(Segment &seg)
+        {
+            if (seg._fd < 0)
+                return;
+            size_t pos = 0;
+            while (pos < seg._buffer.size())
+            {
+                ssize_t ret = ::write(seg._fd, &seg._buffer[pos], seg._buffer.size() - pos);
+                if (ret < 0 && errno == EINTR)
+                    continue;
+                if (ret <= 0)
+                    break;
+                pos += ret;
+            }
+            seg._index.reset();
+            struct stat st;
+            if (fstat(seg._fd, &st) == 0)
+                ftruncate(seg._fd, st.st_size);
+            ::close(seg._fd);
+        }
+
+        // 后台线程：关闭旧文件，准备下一个文件
+        void threadEntry()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true)
+            {
+                _cond.wait(lock, [&]()
+                           { return _stop || !_closing.empty() || _next == nullptr; });
+                if (!_closing.empty())
+                {
+                    std::vector<Segment> closing;
+                    closing.swap(_closing);
+                    RollCallback cb = _on_roll;
+                    _releasing = closing.size();
+                    lock.unlock();
+                    for (auto &seg : closing)
+                        release(seg);
+                    lock.lock();
+                    _releasing = 0;
+                    _cond.notify_all(); // 唤醒等待旧文件写完的 flush
+                    lock.unlock();
+                    if (cb)
+                    {
+                        for (auto &seg : closing)
+                            cb(seg._pathname);
+                    }
+                    lock.lock();
+                    continue;
+                }
+                if (_stop)
+                    break;
+                lock.unlock();
+                Segment *seg = prepare();
+                lock.lock();
+                if (seg->_fd < 0)
+                {
+                    // 创建失败，稍后由切换文件时当场重试
+                    seg->_index.reset();
+                    delete seg;
+                    _cond.wait(lock, [&]()
+                               { return _stop || !_closing.empty(); });
+                    continue;
+                }
+                _next = seg;
+            }
+        }
+
         std::string createNewFile()
         {
             time_t t = util::Date::now();
@@ -120,10 +553,244 @@ namespace logsys
     private:
         // 通过基础文件名+拓展文件名组成实际当前输出文件名
         std::string _basename;
-        std::ofstream _ofs;
-        size_t _name_count;
+        std::atomic<size_t> _name_count;
         size_t _max_fsize; // 规定的文件最大大小
         size_t _cur_fsize; // 记录当前文件大小
+        size_t _index_block;
+        std::string _pathname; // 当前文件名
+        std::unique_ptr<IndexWriter> _index;
+
+        // 以下成员由 _mutex 保护，与后台线程共享
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        bool _stop;
+        Segment *_next;                // 提前创建好的下一个文件，为nullptr时后台线程负责创建
+        std::vector<Segment> _closing; // 等待关闭的旧文件
+        size_t _releasing;             // 后台线程正在写出并关闭的旧文件个数
+        RollCallback _on_roll;
+        std::thread _thread;
+    };
+
+    // 异步落地方向的队列已满时的处理策略
+    enum class OverflowPolicy
+    {
+        BLOCK, // 阻塞等待队列有空闲空间，不丢失日志
+        DROP   // 直接丢弃当前日志并计数，不阻塞调用者
+    };
+
+    // 异步落地方向的运行统计
+    struct SinkStats
+    {
+        uint64_t _records; // 进入队列的日志数量
+        uint64_t _bytes;   // 进入队列的数据大小
+        uint64_t _dropped; // 因队列已满被丢弃的日志数量
+        uint64_t _batches; // 工作线程批量落地的次数
+    };
+
+#define ASYNC_SINK_BUFFER_SIZE (1 * 1024 * 1024)
+    // 落地方向：为被包装的落地方向提供独立的有界队列与工作线程
+    // 被包装的落地方向需要逐条日志的元信息时，队列中每条日志前附加其元信息
+    class AsyncSink : public LogSink
+    {
+    public:
+        AsyncSink(const LogSink::ptr &sink,
+                  OverflowPolicy policy = OverflowPolicy::BLOCK,
+                  size_t capacity = ASYNC_SINK_BUFFER_SIZE)
+            : _sink(sink),
+              _policy(policy),
+              _records(0),
+              _bytes(0),
+              _dropped(0),
+              _batches(0),
+              _framed(sink->wantsRecords()),
+              _looper(std::make_shared<AsyncLooper>(std::bind(&AsyncSink::realLog, this, std::placeholders::_1),
+                                                    AsyncType::ASYNC_SAFE, capacity))
+        {
+            // 沿用被包装落地方向的输出等级与格式化器
+            _level = sink->level();
+            _formatter = sink->formatter();
+        }
+
+        ~AsyncSink()
+        {
+            _looper->stop();
+        }
+
+        void log(const char *data, size_t len)
+        {
+            if (_framed)
+            {
+                RecordInfo info = {0, 0, (uint32_t)len, 0}; // _logger 为0表示不带元信息的数据
+                enqueue((const char *)&info, sizeof(info), data, len);
+            }
+            else
+            {
+                enqueue(nullptr, 0, data, len);
+            }
+        }
+
+        bool wantsRecords() const
+        {
+            return _framed;
+        }
+
+        // 格式化在日志器中完成，是否输出颜色由被包装的落地方向决定
+        bool colored() const
+        {
+            return _sink->colored();
+        }
+
+        void logRecords(const char *data, size_t, const RecordInfo *infos, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                enqueue((const char *)&infos[i], sizeof(RecordInfo), data, infos[i]._len);
+                data += infos[i]._len;
+            }
+        }
+
+        // 等待队列中已有的日志全部落地
+        void flush()
+        {
+            _looper->flush(std::chrono::milliseconds(LOG_FLUSH_TIMEOUT_MS));
+        }
+
+        SinkStats stats() const
+        {
+            SinkStats st;
+            st._records = _records.load(std::memory_order_relaxed);
+            st._bytes = _bytes.load(std::memory_order_relaxed);
+            st._dropped = _dropped.load(std::memory_order_relaxed);
+            st._batches = _batches.load(std::memory_order_relaxed);
+            return st;
+        }
+
+    private:
+        void enqueue(const char *head, size_t head_len, const char *data, size_t len)
+        {
+            if (_policy == OverflowPolicy::BLOCK)
+            {
+                if (head_len > 0)
+                    _looper->push(head, head_len, data, len);
+                else
+                    _looper->push(data, len);
+            }
+            else if ((head_len > 0 ? _looper->tryPush(head, head_len, data, len) : _looper->tryPush(data, len)) == false)
+            {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                // 同步日志器在输出线程中调用，可将丢弃计入日志语句的调用位置
+                if (CallSite::current() != nullptr)
+                    CallSite::current()->drop();
+                return;
+            }
+            _records.fetch_add(1, std::memory_order_relaxed);
+            _bytes.fetch_add(len, std::memory_order_relaxed);
+        }
+
+        // 每批日志落地后立即刷新被包装的落地方向，flush 返回时日志已交给操作系统
+        void realLog(Buffer &buf)
+        {
+            std::unique_lock<std::mutex> lock(_sink->writeMutex());
+            if (_framed)
+                deliverRecords(buf.begin(), buf.begin() + buf.readAbleSize());
+            else
+                _sink->log(buf.begin(), buf.readAbleSize());
+            _sink->flush();
+            _batches.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // 拆出每条日志的元信息，连续的日志一次交给被包装的落地方向
+        void deliverRecords(const char *ptr, const char *end)
+        {
+            _data.clear();
+            _infos.clear();
+            while (ptr < end)
+            {
+                RecordInfo info;
+                memcpy(&info, ptr, sizeof(info));
+                ptr += sizeof(info);
+                if (info._logger == 0)
+                {
+                    deliverPending();
+                    _sink->log(ptr, info._len);
+                }
+                else
+                {
+                    _data.insert(_data.end(), ptr, ptr + info._len);
+                    _infos.push_back(info);
+                }
+                ptr += info._len;
+            }
+            deliverPending();
+        }
+
+        void deliverPending()
+        {
+            if (_infos.empty())
+                return;
+            _sink->logRecords(_data.data(), _data.size(), _infos.data(), _infos.size());
+            _data.clear();
+            _infos.clear();
+        }
+
+    private:
+        LogSink::ptr _sink;
+        OverflowPolicy _policy;
+        std::atomic<uint64_t> _records;
+        std::atomic<uint64_t> _bytes;
+        std::atomic<uint64_t> _dropped;
+        std::atomic<uint64_t> _batches;
+        bool _framed;                   // 队列中的日志带有元信息
+        std::vector<char> _data;        // 工作线程拼接带元信息日志的缓冲区
+        std::vector<RecordInfo> _infos;
+        AsyncLooper::ptr _looper;
+    };
+
+    // 落地方向的视图：日志原样转发给被包装的落地方向，输出等级与格式化器独立设置
+    // 配置重新加载时复用已打开的落地方向，新配置的等级与格式化器设置在新建的视图上，不修改正在使用的落地方向
+    class SinkView : public LogSink
+    {
+    public:
+        SinkView(const LogSink::ptr &sink) : _sink(sink) {}
+
+        void log(const char *data, size_t len)
+        {
+            _sink->log(data, len);
+        }
+
+        void flush()
+        {
+            _sink->flush();
+        }
+
+        bool colored() const
+        {
+            return _sink->colored();
+        }
+
+        bool wantsRecords() const
+        {
+            return _sink->wantsRecords();
+        }
+
+        void logRecords(const char *data, size_t len, const RecordInfo *infos, size_t count)
+        {
+            _sink->logRecords(data, len, infos, count);
+        }
+
+        const LogSink::ptr &target() const
+        {
+            return _sink;
+        }
+
+        // 与被包装的落地方向使用同一把写入锁，新旧配置的视图可能同时被使用
+        std::mutex &writeMutex()
+        {
+            return _sink->writeMutex();
+        }
+
+    private:
+        LogSink::ptr _sink;
     };
 
     class SinkFactory
@@ -0,0 +1,440 @@
+/*
+    套接字落地方向：
+    1. 数据报（UDP/Unix域数据报）：按行拆分日志，使用 sendmmsg 批量发送，每行一个数据报
+    2. 字节流（TCP/Unix域字节流）：日志按行连续发送，将积压数据与新数据通过一次 sendmsg 合并发送，
+       只发送了一部分的日志在重连后完整重发，统计中的日志数量只包括完整发送的日志
+    3. 套接字均为非阻塞模式，发送失败时丢弃并计数，连接断开后按指数退避重连，不会阻塞调用线程
+    4. 配合 SyslogFormatter 可按 RFC5424 格式发送至本地日志代理
+*/
+#ifndef __M_SOCKET_H__
+#define __M_SOCKET_H__
+
+#include "sink.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+namespace logsys
+{
+#define SOCKET_BATCH_SIZE 64
+#define SOCKET_PENDING_SIZE (1 * 1024 * 1024)
+#define SOCKET_BACKOFF_MIN_MS 100
+#define SOCKET_BACKOFF_MAX_MS 30000
+
+    // 套接字地址，支持 IPv4 数字地址与 Unix 域路径
+    struct SockAddr
+    {
+        sockaddr_storage _addr;
+        socklen_t _len;
+        int _family;
+
+        static SockAddr inet(const std::string &ip, uint16_t port)
+        {
+            SockAddr sa;
+            memset(&sa, 0, sizeof(sa));
+            sockaddr_in *in = (sockaddr_in *)&sa._addr;
+            in->sin_family = AF_INET;
+            in->sin_port = htons(port);
+            int ret = inet_pton(AF_INET, ip.c_str(), &in->sin_addr);
+            assert(ret == 1);
+            (void)ret;
+            sa._len = sizeof(sockaddr_in);
+            sa._family = AF_INET;
+            return sa;
+        }
+
+        static SockAddr local(const std::string &path)
+        {
+            SockAddr sa;
+            memset(&sa, 0, sizeof(sa));
+            sockaddr_un *un = (sockaddr_un *)&sa._addr;
+            un->sun_family = AF_UNIX;
+            assert(path.size() < sizeof(un->sun_path));
+            memcpy(un->sun_path, path.c_str(), path.size());
+            sa._len = sizeof(sockaddr_un);
+            sa._family = AF_UNIX;
+            return sa;
+        }
+    };
+
+    // 套接字落地方向基类：管理非阻塞连接与断线重连的退避
+    class SocketSink : public LogSink
+    {
+    public:
+        SocketSink(const SockAddr &addr, int type)
+            : _addr(addr),
+              _type(type),
+              _fd(-1),
+              _connecting(false),
+              _backoff_ms(0),
+              _records(0),
+              _bytes(0),
+              _dropped(0),
+              _batches(0)
+        {
+        }
+
+        ~SocketSink()
+        {
+            closeSocket();
+        }
+
+        SinkStats stats() const
+        {
+            SinkStats st;
+            st._records = _records.load(std::memory_order_relaxed);
+            st._bytes = _bytes.load(std::memory_order_relaxed);
+            st._dropped = _dropped.load(std::memory_order_relaxed);
+            st._batches = _batches.load(std::memory_order_relaxed);
+            return st;
+        }
+
+    protected:
+        // 尝试建立连接，处于退避期间直接返回false
+        bool ensureSocket()
+        {
+            if (_fd >= 0)
+                return true;
+            auto now = std::chrono::steady_clock::now();
+            if (_backoff_ms > 0 && now < _retry_at)
+                return false;
+            _fd = socket(_addr._family, _type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (_fd < 0)
+            {
+                failed();
+                return false;
+            }
+            int ret = connect(_fd, (const sockaddr *)&_addr._addr, _addr._len);
+            if (ret < 0 && errno != EINPROGRESS)
+            {
+                failed();
+                return false;
+            }
+            _connecting = (ret < 0);
+            return true;
+        }
+
+        // 连接失败或断开：关闭套接字并延长退避时间
+        void failed()
+        {
+            closeSocket();
+            disconnected();
+            _backoff_ms = _backoff_ms == 0 ? SOCKET_BACKOFF_MIN_MS : std::min(_backoff_ms * 2, (size_t)SOCKET_BACKOFF_MAX_MS);
+            _retry_at = std::chrono::steady_clock::now() + std::chrono::milliseconds(_backoff_ms);
+        }
+
+        void succeeded()
+        {
+            _backoff_ms = 0;
+        }
+
+        // 连接断开，之后将使用新的连接
+        virtual void disconnected() {}
+
+        void closeSocket()
+        {
+            if (_fd >= 0)
+                close(_fd);
+            _fd = -1;
+            _connecting = false;
+        }
+
+    protected:
+        SockAddr _addr;
+        int _type;
+        int _fd;
+        bool _connecting; // 非阻塞连接尚未完成
+        size_t _backoff_ms;
+        std::chrono::steady_clock::time_point _retry_at;
+        // 统计信息由发送线程更新，stats() 可在其他线程中读取
+        std::atomic<uint64_t> _records; // 成功发送的日志数量
+        std::atomic<uint64_t> _bytes;   // 成功发送的数据大小
+        std::atomic<uint64_t> _dropped; // 被丢弃的日志数量
+        std::atomic<uint64_t> _batches; // 发送的系统调用次数
+    };
+
+    // 落地方向：数据报套接字，每行日志作为一个数据报发送
+    class DgramSink : public SocketSink
+    {
+    public:
+        DgramSink(const SockAddr &addr) : SocketSink(addr, SOCK_DGRAM) {}
+
+        void log(const char *data, size_t len)
+        {
+            const char *end = data + len;
+            while (data < end)
+            {
+                // 1. 按行拆分，组织一批待发送的数据报（不拷贝数据）
+                size_t count = 0;
+                while (data < end && count < SOCKET_BATCH_SIZE)
+                {
+                    const char *nl = (const char *)memchr(data, '\n', end - data);
+                    const char *next = nl ? nl + 1 : end;
+                    size_t n = (nl ? nl : end) - data;
+                    if (n > 0)
+                    {
+                        _iov[count].iov_base = (void *)data;
+                        _iov[count].iov_len = n;
+                        count++;
+                    }
+                    data = next;
+                }
+                if (count == 0)
+                    continue;
+                // 2. 批量发送，发送失败的部分直接丢弃
+                size_t sent = send(count);
+                _dropped.fetch_add(count - sent, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        size_t send(size_t count)
+        {
+            if (!ensureSocket())
+                return 0;
+            mmsghdr msgs[SOCKET_BATCH_SIZE];
+            memset(msgs, 0, sizeof(mmsghdr) * count);
+            for (size_t i = 0; i < count; i++)
+            {
+                msgs[i].msg_hdr.msg_iov = &_iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            int ret = sendmmsg(_fd, msgs, count, MSG_DONTWAIT | MSG_NOSIGNAL);
+            _batches.fetch_add(1, std::memory_order_relaxed);
+            if (ret < 0)
+            {
+                // 接收方暂时无法接收时丢弃，接收方不存在时重连
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS)
+                    failed();
+                return 0;
+            }
+            succeeded();
+            uint64_t bytes = 0;
+            for (int i = 0; i < ret; i++)
+                bytes += msgs[i].msg_len;
+            _bytes.fetch_add(bytes, std::memory_order_relaxed);
+            _records.fetch_add(ret, std::memory_order_relaxed);
+            return ret;
+        }
+
+    private:
+        iovec _iov[SOCKET_BATCH_SIZE];
+    };
+
+    // 落地方向：字节流套接字，对端暂时无法接收时积压至有界缓冲区，超出上限的日志被丢弃
+    // 积压缓冲区只保存完整的日志，首条日志在当前连接上已发送的部分单独记录，
+    // 重连后从首条日志的开头重新发送，对端在新连接上收到的总是完整的日志
+    class StreamSink : public SocketSink
+    {
+    public:
+        StreamSink(const SockAddr &addr, size_t max_pending = SOCKET_PENDING_SIZE)
+            : SocketSink(addr, SOCK_STREAM), _max_pending(max_pending), _head_sent(0)
+        {
+        }
+
+        void log(const char *data, size_t len)
+        {
+            send(data, len);
+        }
+
+        // 尝试发送积压的数据
+        void flush()
+        {
+            if (!_pending.empty())
+                send(nullptr, 0);
+        }
+
+    private:
+        void send(const char *data, size_t len)
+        {
+            if (!ensureSocket() || !connected())
+            {
+                keep(data, len);
+                return;
+            }
+            // 积压数据与新数据通过一次 sendmsg（writev 的套接字版本，可避免对端关闭时触发 SIGPIPE）发送
+            iovec iov[2];
+            int cnt = 0;
+            size_t backlog = _pending.size() - _head_sent;
+            if (backlog > 0)
+            {
+                iov[cnt].iov_base = &_pending[_head_sent];
+                iov[cnt].iov_len = backlog;
+                cnt++;
+            }
+            if (len > 0)
+            {
+                iov[cnt].iov_base = (void *)data;
+                iov[cnt].iov_len = len;
+                cnt++;
+            }
+            msghdr hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_iov = iov;
+            hdr.msg_iovlen = cnt;
+            ssize_t ret = sendmsg(_fd, &hdr, MSG_DONTWAIT | MSG_NOSIGNAL);
+            _batches.fetch_add(1, std::memory_order_relaxed);
+            if (ret < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    failed();
+                keep(data, len);
+                return;
+            }
+            succeeded();
+            _bytes.fetch_add(ret, std::memory_order_relaxed);
+            size_t sent = ret;
+            if (sent < backlog)
+            {
+                consume(sent);
+                keep(data, len);
+                return;
+            }
+            consume(backlog);
+            sent -= backlog;
+            // 新数据可能包含多条日志（异步日志器整批输出），逐条统计完整发送的日志
+            const char *end = data + len;
+            const char *sent_end = data + sent;
+            while (data < end)
+            {
+                const char *next = recordEnd(data, end);
+                if (next > sent_end)
+                    break;
+                _records.fetch_add(1, std::memory_order_relaxed);
+                data = next;
+            }
+            if (data == end)
+                return;
+            if (data < sent_end)
+            {
+                // 已发送了一部分的日志必须完整保留，避免破坏按行分隔
+                const char *next = recordEnd(data, end);
+                keep(data, next - data, true);
+                _head_sent = sent_end - data;
+                data = next;
+            }
+            keep(data, end - data);
+        }
+
+        // 一条日志的结尾（换行之后），没有换行时为数据末尾
+        static const char *recordEnd(const char *data, const char *end)
+        {
+            const char *nl = (const char *)memchr(data, '\n', end - data);
+            return nl ? nl + 1 : end;
+        }
+
+        // 积压数据中又有n字节发送成功，移除已完整发送的日志
+        void consume(size_t n)
+        {
+            size_t pos = _head_sent + n;
+            size_t done = 0;
+            while (!_lengths.empty() && pos >= done + _lengths.front())
+            {
+                done += _lengths.front();
+                _lengths.pop_front();
+                _records.fetch_add(1, std::memory_order_relaxed);
+            }
+            _pending.erase(_pending.begin(), _pending.begin() + done);
+            _head_sent = pos - done;
+        }
+
+        // 检查非阻塞连接是否完成
+        bool connected()
+        {
+            if (!_connecting)
+                return true;
+            pollfd pfd = {_fd, POLLOUT, 0};
+            if (poll(&pfd, 1, 0) <= 0)
+                return false;
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err != 0)
+            {
+                failed();
+                return false;
+            }
+            _connecting = false;
+            return true;
+        }
+
+        // 首条日志在旧连接上只发送了一部分，在新连接上完整重发
+        void disconnected() override
+        {
+            _head_sent = 0;
+        }
+
+        // 按行拆分后逐条积压，超出上限的日志逐条丢弃
+        void keep(const char *data, size_t len, bool force = false)
+        {
+            const char *end = data + len;
+            while (data < end)
+            {
+                const char *next = recordEnd(data, end);
+                size_t n = next - data;
+                if (!force && _pending.size() + n > _max_pending)
+                {
+                    _dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+                else
+                {
+                    _pending.insert(_pending.end(), data, next);
+                    _lengths.push_back(n);
+                }
+                data = next;
+            }
+        }
+
+    private:
+        size_t _max_pending;
+        std::vector<char> _pending;  // 尚未完整发送的日志
+        std::deque<size_t> _lengths; // 积压缓冲区中各条日志的长度
+        size_t _head_sent;           // 首条日志在当前连接上已发送的字节数
+    };
+
+    // 落地方向：UDP，发送至本机日志代理
+    class UdpSink : public DgramSink
+    {
+    public:
+        UdpSink(const std::string &ip, uint16_t port) : DgramSink(SockAddr::inet(ip, port)) {}
+    };
+
+    // 落地方向：Unix域数据报，例如 /dev/log
+    class UnixDgramSink : public DgramSink
+    {
+    public:
+        UnixDgramSink(const std::string &path) : DgramSink(SockAddr::local(path)) {}
+    };
+
+    // 落地方向：TCP
+    class TcpSink : public StreamSink
+    {
+    public:
+        TcpSink(const std::string &ip, uint16_t port, size_t max_pending = SOCKET_PENDING_SIZE)
+            : StreamSink(SockAddr::inet(ip, port), max_pending)
+        {
+        }
+    };
+
+    // 落地方向：Unix域字节流
+    class UnixStreamSink : public StreamSink
+    {
+    public:
+        UnixStreamSink(const std::string &path, size_t max_pending = SOCKET_PENDING_SIZE)
+            : StreamSink(SockAddr::local(path), max_pending)
+        {
+        }
+    };
+}
+
+#endif
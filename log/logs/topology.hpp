@@ -0,0 +1,98 @@
+/*
+    CPU拓扑：
+    1. 从 /sys/devices/system/node 读取每个NUMA节点包含的CPU，不支持NUMA的系统视为一个节点
+    2. 解析 "0-3,8-11" 形式的CPU列表
+    3. 将当前线程绑定至指定的CPU集合
+*/
+#ifndef __M_TOPOLOGY_H__
+#define __M_TOPOLOGY_H__
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+namespace logsys
+{
+    namespace util
+    {
+        class Topology
+        {
+        public:
+            // 解析CPU列表字符串，如 "0-3,8,10-11"
+            static std::vector<int> parseCpuList(const std::string &str)
+            {
+                std::vector<int> cpus;
+                std::stringstream ss(str);
+                std::string item;
+                while (std::getline(ss, item, ','))
+                {
+                    if (item.empty() || item[0] < '0' || item[0] > '9')
+                        continue;
+                    char *end = nullptr;
+                    int first = (int)strtol(item.c_str(), &end, 10);
+                    int last = first;
+                    if (*end == '-')
+                        last = (int)strtol(end + 1, nullptr, 10);
+                    for (int cpu = first; cpu <= last; cpu++)
+                        cpus.push_back(cpu);
+                }
+                return cpus;
+            }
+
+            // 每个NUMA节点包含的CPU，无法读取时返回包含全部在线CPU的一个节点
+            static std::vector<std::vector<int>> nodes()
+            {
+                std::vector<std::vector<int>> res;
+                for (int node = 0;; node++)
+                {
+                    std::stringstream path;
+                    path << "/sys/devices/system/node/node" << node << "/cpulist";
+                    std::ifstream ifs(path.str().c_str());
+                    if (!ifs.is_open())
+                        break;
+                    std::string list;
+                    std::getline(ifs, list);
+                    std::vector<int> cpus = parseCpuList(list);
+                    // 没有CPU的节点（如仅有内存的节点）不需要队列
+                    if (!cpus.empty())
+                        res.push_back(cpus);
+                }
+                if (res.empty())
+                {
+                    std::vector<int> cpus;
+                    long count = sysconf(_SC_NPROCESSORS_ONLN);
+                    for (long i = 0; i < count; i++)
+                        cpus.push_back((int)i);
+                    res.push_back(cpus);
+                }
+                return res;
+            }
+
+            // 当前线程所在的CPU，获取失败返回-1
+            static int currentCpu()
+            {
+                return sched_getcpu();
+            }
+
+            // 将当前线程绑定至指定的CPU集合
+            static bool bind(const std::vector<int> &cpus)
+            {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (int cpu : cpus)
+                {
+                    if (cpu >= 0 && cpu < CPU_SETSIZE)
+                        CPU_SET(cpu, &set);
+                }
+                return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+            }
+        };
+    }
+}
+
+#endif
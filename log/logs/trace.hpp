@@ -0,0 +1,382 @@
+/*
+    负载录制：
+    1. Trace::start(path) 开始录制，之后每条输出的日志记录其时间，线程，等级，消息大小与调用位置，不记录消息内容
+    2. 各线程先写入线程局部的缓冲区，满 TRACE_CHUNK_RECORDS 条后整块写入文件，
+       时间记录为与本线程上一条日志的差值（纳秒），与大小，调用位置一起以变长整数编码，每条约 5~8 字节
+    3. 调用位置首次出现时写入其文件名与行号，记录中只保存编号
+    4. Trace::stop() 写入全部线程剩余的记录后关闭文件
+    5. TraceReader 读取录制文件，按线程还原每条日志的时间，供回放使用（bench/replay.cc）
+    文件格式：
+        "LOGTRACE" 版本(u32)
+        'S' 编号(u32) 行号(u32) 文件名长度(u16) 文件名
+        'C' 线程编号(u32) 条数(u32) 字节数(u32) 记录：时间差(varint) 等级(u8) 大小(varint) 调用位置(varint)
+    注意：未录制时日志输出路径上只多一次 relaxed 原子读取；整数按本机字节序写入，录制与回放应在同类机器上进行
+*/
+#ifndef __M_TRACE_H__
+#define __M_TRACE_H__
+
+#include "level.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace logsys
+{
+#define TRACE_MAGIC "LOGTRACE"
+#define TRACE_VERSION 1
+#define TRACE_CHUNK_RECORDS 4096 // 线程局部缓冲区写满多少条后写入文件
+
+    class Trace
+    {
+    public:
+        // 开始录制至 path，已在录制时先结束之前的录制
+        static bool start(const std::string &path)
+        {
+            stop();
+            Trace &t = instance();
+            std::unique_lock<std::mutex> lock(t._mutex);
+            t._fp = fopen(path.c_str(), "wb");
+            if (t._fp == nullptr)
+                return false;
+            fwrite(TRACE_MAGIC, 1, 8, t._fp);
+            uint32_t version = TRACE_VERSION;
+            fwrite(&version, sizeof(version), 1, t._fp);
+            t._sites.clear();
+            t._threads = 0;
+            t._start.store(steadyNs(), std::memory_order_relaxed);
+            t._session++;
+            t._capturing.store(true, std::memory_order_release);
+            return true;
+        }
+
+        // 结束录制，写入各线程缓冲区中剩余的记录
+        static void stop()
+        {
+            Trace &t = instance();
+            std::vector<std::shared_ptr<Local>> locals;
+            {
+                std::unique_lock<std::mutex> lock(t._mutex);
+                if (t._fp == nullptr)
+                    return;
+                t._capturing.store(false, std::memory_order_release);
+                locals = t._locals;
+            }
+            // 加锁顺序与 record 一致：先线程缓冲区，后 Trace
+            for (auto &local : locals)
+            {
+                std::unique_lock<std::mutex> guard(local->_mutex);
+                std::unique_lock<std::mutex> lock(t._mutex);
+                if (t._fp != nullptr && local->_session == t._session)
+                    t.writeChunk(*local);
+            }
+            std::unique_lock<std::mutex> lock(t._mutex);
+            if (t._fp != nullptr)
+                fclose(t._fp);
+            t._fp = nullptr;
+        }
+
+        static bool capturing()
+        {
+            return instance()._capturing.load(std::memory_order_relaxed);
+        }
+
+        // 记录一条日志，file 为空表示不经过格式化的日志（logRaw）
+        static void record(LogLevel::value level, const char *file, size_t line, size_t size)
+        {
+            Trace &t = instance();
+            Local &local = *Holder::local()._local;
+            std::unique_lock<std::mutex> guard(local._mutex);
+            uint64_t session = t._session.load(std::memory_order_acquire);
+            if (local._session != session)
+            {
+                // 新的录制：重新分配线程编号，清空调用位置缓存
+                std::unique_lock<std::mutex> lock(t._mutex);
+                if (t._fp == nullptr)
+                    return;
+                local._session = session;
+                local._thread = t._threads++;
+                local._last = 0;
+                local._count = 0;
+                local._data.clear();
+                local._sites.clear();
+            }
+            int64_t elapsed = steadyNs() - t._start.load(std::memory_order_relaxed);
+            uint64_t now = elapsed > 0 ? (uint64_t)elapsed : 0;
+            uint32_t site = local.site(t, file, line);
+            putVarint(local._data, now > local._last ? now - local._last : 0);
+            local._data.push_back((char)level);
+            putVarint(local._data, size);
+            putVarint(local._data, site);
+            local._last = now;
+            if (++local._count >= TRACE_CHUNK_RECORDS)
+            {
+                std::unique_lock<std::mutex> lock(t._mutex);
+                if (t._fp != nullptr && t._session == session)
+                    t.writeChunk(local);
+            }
+        }
+
+        static void putVarint(std::string &out, uint64_t val)
+        {
+            while (val >= 0x80)
+            {
+                out.push_back((char)(val | 0x80));
+                val >>= 7;
+            }
+            out.push_back((char)val);
+        }
+
+        static bool getVarint(const char *&pos, const char *end, uint64_t &val)
+        {
+            val = 0;
+            for (int shift = 0; pos < end && shift < 64; shift += 7)
+            {
+                uint8_t byte = (uint8_t)*pos++;
+                val |= (uint64_t)(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0)
+                    return true;
+            }
+            return false;
+        }
+
+    private:
+        // 线程局部的录制缓冲区，由线程与 Trace 共同持有，stop 时由 Trace 写入剩余记录
+        struct Local
+        {
+            Local() : _session(0), _thread(0), _last(0), _count(0) {}
+
+            // 调用位置编号，首次出现时分配并写入文件（需持有 _mutex）
+            uint32_t site(Trace &t, const char *file, size_t line)
+            {
+                std::pair<const char *, size_t> key(file, line);
+                auto it = _sites.find(key);
+                if (it != _sites.end())
+                    return it->second;
+                std::unique_lock<std::mutex> lock(t._mutex);
+                uint32_t id = t.siteId(file == nullptr ? "" : file, line);
+                _sites.insert(std::make_pair(key, id));
+                return id;
+            }
+
+            std::mutex _mutex;
+            uint64_t _session;
+            uint32_t _thread;
+            uint64_t _last; // 上一条日志的时间（纳秒，相对录制开始）
+            uint32_t _count;
+            std::string _data;
+            std::map<std::pair<const char *, size_t>, uint32_t> _sites;
+        };
+
+        // 线程退出时写入剩余记录并从 Trace 中移除
+        struct Holder
+        {
+            Holder() : _local(std::make_shared<Local>())
+            {
+                Trace &t = instance();
+                std::unique_lock<std::mutex> lock(t._mutex);
+                t._locals.push_back(_local);
+            }
+            ~Holder()
+            {
+                Trace &t = instance();
+                std::unique_lock<std::mutex> guard(_local->_mutex);
+                std::unique_lock<std::mutex> lock(t._mutex);
+                if (t._fp != nullptr && _local->_session == t._session)
+                    t.writeChunk(*_local);
+                for (size_t i = 0; i < t._locals.size(); i++)
+                {
+                    if (t._locals[i] == _local)
+                    {
+                        t._locals.erase(t._locals.begin() + i);
+                        break;
+                    }
+                }
+            }
+            static Holder &local()
+            {
+                static thread_local Holder holder;
+                return holder;
+            }
+            std::shared_ptr<Local> _local;
+        };
+
+        Trace() : _fp(nullptr), _capturing(false), _session(0), _threads(0), _start(0) {}
+        ~Trace()
+        {
+            if (_fp != nullptr)
+                fclose(_fp);
+        }
+
+        static int64_t steadyNs()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        static Trace &instance()
+        {
+            static Trace trace;
+            return trace;
+        }
+
+        // 同一文件名与行号只分配一个编号，录制已结束时只分配编号（需持有 _mutex）
+        uint32_t siteId(const std::string &file, size_t line)
+        {
+            std::pair<std::string, size_t> key(file, line);
+            auto it = _sites.find(key);
+            if (it != _sites.end())
+                return it->second;
+            uint32_t id = (uint32_t)_sites.size();
+            _sites.insert(std::make_pair(key, id));
+            if (_fp == nullptr)
+                return id;
+            uint32_t line32 = (uint32_t)line;
+            uint16_t len = (uint16_t)std::min(file.size(), (size_t)UINT16_MAX);
+            fputc('S', _fp);
+            fwrite(&id, sizeof(id), 1, _fp);
+            fwrite(&line32, sizeof(line32), 1, _fp);
+            fwrite(&len, sizeof(len), 1, _fp);
+            fwrite(file.data(), 1, len, _fp);
+            return id;
+        }
+
+        // 写入线程缓冲区中的记录（需持有 _mutex 与 local._mutex）
+        void writeChunk(Local &local)
+        {
+            if (local._count == 0)
+                return;
+            uint32_t bytes = (uint32_t)local._data.size();
+            fputc('C', _fp);
+            fwrite(&local._thread, sizeof(local._thread), 1, _fp);
+            fwrite(&local._count, sizeof(local._count), 1, _fp);
+            fwrite(&bytes, sizeof(bytes), 1, _fp);
+            fwrite(local._data.data(), 1, bytes, _fp);
+            local._data.clear();
+            local._count = 0;
+        }
+
+    private:
+        std::mutex _mutex; // 保护文件，调用位置表与线程列表
+        FILE *_fp;
+        std::atomic<bool> _capturing;
+        std::atomic<uint64_t> _session; // 每次 start 递增，线程缓冲区据此判断是否属于本次录制
+        uint32_t _threads;
+        std::atomic<int64_t> _start; // 录制开始的时间（纳秒）
+        std::map<std::pair<std::string, size_t>, uint32_t> _sites;
+        std::vector<std::shared_ptr<Local>> _locals;
+    };
+
+    // 读取录制文件
+    class TraceReader
+    {
+    public:
+        struct Event
+        {
+            uint64_t _time; // 纳秒，相对录制开始
+            LogLevel::value _level;
+            uint32_t _size;
+            uint32_t _site;
+        };
+
+        struct Site
+        {
+            std::string _file; // 为空表示不经过格式化的日志
+            size_t _line;
+        };
+
+        bool load(const std::string &path)
+        {
+            FILE *fp = fopen(path.c_str(), "rb");
+            if (fp == nullptr)
+                return fail("打开录制文件失败：" + path);
+            std::unique_ptr<FILE, int (*)(FILE *)> guard(fp, fclose);
+            char magic[8];
+            uint32_t version = 0;
+            if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, TRACE_MAGIC, 8) != 0 ||
+                fread(&version, sizeof(version), 1, fp) != 1 || version != TRACE_VERSION)
+                return fail("不是录制文件或版本不符：" + path);
+            _threads.clear();
+            _sites.clear();
+            std::vector<uint64_t> last; // 各线程上一条日志的时间
+            int tag;
+            while ((tag = fgetc(fp)) != EOF)
+            {
+                if (tag == 'S')
+                {
+                    uint32_t id, line;
+                    uint16_t len;
+                    if (fread(&id, sizeof(id), 1, fp) != 1 || fread(&line, sizeof(line), 1, fp) != 1 ||
+                        fread(&len, sizeof(len), 1, fp) != 1)
+                        return fail("调用位置表不完整");
+                    std::string file(len, '\0');
+                    if (len > 0 && fread(&file[0], 1, len, fp) != len)
+                        return fail("调用位置表不完整");
+                    if (_sites.size() <= id)
+                        _sites.resize(id + 1);
+                    _sites[id]._file = file;
+                    _sites[id]._line = line;
+                }
+                else if (tag == 'C')
+                {
+                    uint32_t thread, count, bytes;
+                    if (fread(&thread, sizeof(thread), 1, fp) != 1 || fread(&count, sizeof(count), 1, fp) != 1 ||
+                        fread(&bytes, sizeof(bytes), 1, fp) != 1)
+                        return fail("记录块不完整");
+                    std::string data(bytes, '\0');
+                    if (bytes > 0 && fread(&data[0], 1, bytes, fp) != bytes)
+                        return fail("记录块不完整");
+                    if (_threads.size() <= thread)
+                    {
+                        _threads.resize(thread + 1);
+                        last.resize(thread + 1, 0);
+                    }
+                    const char *pos = data.data(), *end = pos + data.size();
+                    for (uint32_t i = 0; i < count; i++)
+                    {
+                        uint64_t delta, size, site;
+                        if (Trace::getVarint(pos, end, delta) == false || pos >= end)
+                            return fail("记录块损坏");
+                        LogLevel::value level = (LogLevel::value)(uint8_t)*pos++;
+                        if (Trace::getVarint(pos, end, size) == false || Trace::getVarint(pos, end, site) == false)
+                            return fail("记录块损坏");
+                        last[thread] += delta;
+                        Event ev = {last[thread], level, (uint32_t)size, (uint32_t)site};
+                        _threads[thread].push_back(ev);
+                    }
+                }
+                else
+                {
+                    return fail("未知的记录类型");
+                }
+            }
+            return true;
+        }
+
+        // 每个录制线程的日志，按时间先后排列
+        const std::vector<std::vector<Event>> &threads() const { return _threads; }
+        const std::vector<Site> &sites() const { return _sites; }
+        const std::string &lastError() const { return _error; }
+
+    private:
+        bool fail(const std::string &msg)
+        {
+            _error = msg;
+            return false;
+        }
+
+    private:
+        std::vector<std::vector<Event>> _threads;
+        std::vector<Site> _sites;
+        std::string _error;
+    };
+}
+
+#endif
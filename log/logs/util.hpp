@@ -4,6 +4,7 @@
     2. 获取文件大小
     3. 创建目录
     4. 获取文件所在目录
+    5. 获取当前线程的系统线程ID与线程名（线程局部缓存）
 */
 
 #ifndef __M_UTIL_H__
@@ -15,7 +16,11 @@
 #include <string>
 #include <ctime>
 #include <cassert>
+#include <cstring>
+#include <pthread.h>
+#include <unistd.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 
 namespace logsys
 {
@@ -36,6 +41,15 @@ namespace logsys
                 return (stat(name.c_str(), &st) == 0);
             }
 
+            // 获取文件大小，文件不存在时返回0
+            static size_t size(const std::string &name)
+            {
+                struct stat st;
+                if (stat(name.c_str(), &st) != 0)
+                    return 0;
+                return st.st_size;
+            }
+
             //
             static std::string path(const std::string &name)
             {
@@ -75,6 +89,59 @@ namespace logsys
                 }
             }
         };
+
+#define THREAD_NAME_SIZE 16 // 与 pthread_setname_np 的上限一致，包含末尾的 '\0'
+        class Thread
+        {
+        public:
+            // 系统线程ID，首次调用时获取后缓存，与 top/gdb 中显示的一致
+            static pid_t id()
+            {
+                static thread_local pid_t tid = (pid_t)syscall(SYS_gettid);
+                return tid;
+            }
+
+            // 线程名，默认取自系统（未设置时为进程名）
+            static const char *name()
+            {
+                Name &n = local();
+                return n._name;
+            }
+
+            static size_t nameSize()
+            {
+                return local()._size;
+            }
+
+            // 设置当前线程的线程名，超出长度的部分被截断，同时设置系统中的线程名
+            static void setName(const std::string &name)
+            {
+                Name &n = local();
+                n._size = name.size() < THREAD_NAME_SIZE - 1 ? name.size() : THREAD_NAME_SIZE - 1;
+                memcpy(n._name, name.c_str(), n._size);
+                n._name[n._size] = '\0';
+                pthread_setname_np(pthread_self(), n._name);
+            }
+
+        private:
+            struct Name
+            {
+                char _name[THREAD_NAME_SIZE];
+                size_t _size;
+                Name()
+                {
+                    if (pthread_getname_np(pthread_self(), _name, sizeof(_name)) != 0)
+                        _name[0] = '\0';
+                    _size = strlen(_name);
+                }
+            };
+
+            static Name &local()
+            {
+                static thread_local Name name;
+                return name;
+            }
+        };
     }
 }
 
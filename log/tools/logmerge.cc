@@ -0,0 +1,181 @@
+/*
+    日志合并工具：按全局日志序号将多个日志文件（多个落地方向，滚动产生的多个文件）合并为一个按序输出的日志流
+    1. 日志中需要包含序号：格式化规则中加入 seq=%S，或使用 JsonFormatter/LogfmtFormatter（自带 seq 字段）
+    2. 不包含序号的行（如多行消息的后续行）归属于前一条日志
+    3. 单个文件内允许局部乱序（多线程同时写入），每个文件经过一个定长的重排窗口后再进行多路归并
+    用法：logmerge [-k 序号前缀] [-w 窗口大小] 文件...
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#define MERGE_WINDOW_SIZE 10000
+
+struct Record
+{
+    uint64_t _seq;
+    size_t _source; // 来源文件下标，序号相同时保持文件顺序
+    size_t _order;  // 在来源文件中的顺序，序号相同时保持文件内顺序
+    std::string _text;
+};
+
+struct RecordGreater
+{
+    bool operator()(const Record &a, const Record &b) const
+    {
+        if (a._seq != b._seq)
+            return a._seq > b._seq;
+        if (a._source != b._source)
+            return a._source > b._source;
+        return a._order > b._order;
+    }
+};
+
+class Source
+{
+public:
+    Source(const std::string &path, size_t index, const std::vector<std::string> &keys, size_t window)
+        : _ifs(path.c_str()), _index(index), _keys(keys), _window(window), _order(0), _has_line(false)
+    {
+    }
+
+    bool good() const
+    {
+        return _ifs.is_open();
+    }
+
+    // 取出文件中序号最小的一条日志，文件已读完且窗口为空时返回false
+    bool next(Record &rec)
+    {
+        while (_heap.size() < _window)
+        {
+            Record r;
+            if (read(r) == false)
+                break;
+            _heap.push(r);
+        }
+        if (_heap.empty())
+            return false;
+        rec = _heap.top();
+        _heap.pop();
+        return true;
+    }
+
+private:
+    // 读取一条完整的日志，包括其后不含序号的行
+    bool read(Record &rec)
+    {
+        if (_has_line == false && !std::getline(_ifs, _line))
+            return false;
+        _has_line = false;
+        rec._seq = 0;
+        parse(_line, rec._seq);
+        rec._source = _index;
+        rec._order = _order++;
+        rec._text = _line;
+        rec._text.push_back('\n');
+        while (std::getline(_ifs, _line))
+        {
+            uint64_t seq;
+            if (parse(_line, seq))
+            {
+                _has_line = true;
+                break;
+            }
+            rec._text += _line;
+            rec._text.push_back('\n');
+        }
+        return true;
+    }
+
+    bool parse(const std::string &line, uint64_t &seq)
+    {
+        for (const auto &key : _keys)
+        {
+            size_t pos = line.find(key);
+            if (pos == std::string::npos)
+                continue;
+            const char *p = line.c_str() + pos + key.size();
+            if (*p < '0' || *p > '9')
+                continue;
+            seq = strtoull(p, nullptr, 10);
+            return true;
+        }
+        return false;
+    }
+
+private:
+    std::ifstream _ifs;
+    size_t _index;
+    const std::vector<std::string> &_keys;
+    size_t _window;
+    size_t _order;
+    std::string _line; // 预读的下一条日志的首行
+    bool _has_line;
+    std::priority_queue<Record, std::vector<Record>, RecordGreater> _heap; // 重排窗口
+};
+
+static void usage()
+{
+    std::cerr << "用法：logmerge [-k 序号前缀] [-w 窗口大小] 文件...\n"
+              << "  -k  序号前缀，默认识别 seq= 与 \"seq\":\n"
+              << "  -w  每个文件的重排窗口大小（日志条数），默认 " << MERGE_WINDOW_SIZE << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> keys;
+    size_t window = MERGE_WINDOW_SIZE;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+            keys.push_back(argv[++i]);
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+            window = strtoull(argv[++i], nullptr, 10);
+        else if (argv[i][0] == '-')
+            return usage(), 1;
+        else
+            files.push_back(argv[i]);
+    }
+    if (files.empty() || window == 0)
+        return usage(), 1;
+    if (keys.empty())
+    {
+        keys.push_back("seq=");
+        keys.push_back("\"seq\":");
+    }
+
+    // 1. 每个文件取出一条日志放入归并堆
+    std::vector<std::unique_ptr<Source>> sources;
+    std::priority_queue<Record, std::vector<Record>, RecordGreater> heap;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        sources.emplace_back(new Source(files[i], i, keys, window));
+        if (sources[i]->good() == false)
+        {
+            std::cerr << "打开文件失败：" << files[i] << "\n";
+            return 1;
+        }
+        Record rec;
+        if (sources[i]->next(rec))
+            heap.push(rec);
+    }
+    // 2. 每次输出序号最小的日志，并从其来源文件补充下一条
+    while (heap.empty() == false)
+    {
+        Record rec = heap.top();
+        heap.pop();
+        fwrite(rec._text.data(), 1, rec._text.size(), stdout);
+        Record next;
+        if (sources[rec._source]->next(next))
+            heap.push(next);
+    }
+    return 0;
+}
@@ -0,0 +1,420 @@
+/*
+    日志查询工具：借助落地方向写入的稀疏索引（日志文件同名的 .idx 文件），按时间，等级与日志器查询日志
+    1. 日志文件与索引文件均通过 mmap 读取，只访问时间，等级与日志器可能匹配的块，不匹配的块不会被读入内存
+    2. 块的时间范围位于查询范围之内，只含匹配等级的日志且未指定日志器时整块输出，否则逐行判断：
+       行内首个等级名称决定该行的等级，日志器名称需作为独立的单词出现，
+       指定了时间范围时，行内首个 HH:MM:SS（可带前置的 YYYY-mm-dd 日期）为该行的时间，
+       不带日期时取与相邻日志时间相差不超过12小时的那一天，
+       不含等级名称或时间的行（如多行消息的后续行）跟随前一行
+    3. 没有索引的文件，以及索引未覆盖的部分（最后一个未写满的块）按上述规则逐行扫描
+    用法：logquery [-l 最低等级] [-L 日志器] [-f 起始时间] [-t 结束时间] [-n] [-s] 文件...
+*/
+#include "../logs/index.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using logsys::IndexBlock;
+using logsys::IndexHeader;
+using logsys::LogLevel;
+
+// 只读映射整个文件，空文件或映射失败时 data 为nullptr
+class MappedFile
+{
+public:
+    MappedFile(const std::string &path) : _data(nullptr), _size(0)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                _data = (const char *)addr;
+                _size = st.st_size;
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (_data != nullptr)
+            munmap((void *)_data, _size);
+    }
+
+    const char *data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *_data;
+    size_t _size;
+};
+
+struct Query
+{
+    uint32_t _levels;   // 需要的等级位图
+    std::string _logger; // 为空时不过滤
+    uint64_t _logger_bit;
+    int64_t _from;
+    int64_t _to;
+};
+
+struct Stats
+{
+    size_t _blocks;   // 索引中的块数
+    size_t _selected; // 被读取的块数
+    size_t _scanned;  // 被读取的字节数
+    size_t _total;    // 日志文件的总字节数
+    size_t _matched;  // 输出的日志条数（逐行过滤时按行计）
+};
+
+static bool isWordChar(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+// 在[begin, end)中查找作为独立单词出现的word
+static bool findWord(const char *begin, const char *end, const std::string &word)
+{
+    const char *p = begin;
+    while ((size_t)(end - p) >= word.size())
+    {
+        p = (const char *)memmem(p, end - p, word.data(), word.size());
+        if (p == nullptr)
+            return false;
+        bool left = (p == begin || !isWordChar(p[-1]));
+        bool right = (p + word.size() == end || !isWordChar(p[word.size()]));
+        if (left && right)
+            return true;
+        p++;
+    }
+    return false;
+}
+
+// 行内首个等级名称对应的等级，没有等级名称返回-1
+static int lineLevel(const char *begin, const char *end)
+{
+    static const LogLevel::value levels[] = {LogLevel::value::DEBUG, LogLevel::value::INFO, LogLevel::value::WARN,
+                                             LogLevel::value::ERROR, LogLevel::value::FATAL};
+    int found = -1;
+    const char *first = end;
+    for (auto level : levels)
+    {
+        std::string name = LogLevel::toString(level);
+        const char *p = begin;
+        while ((size_t)(end - p) >= name.size())
+        {
+            p = (const char *)memmem(p, end - p, name.data(), name.size());
+            if (p == nullptr || p >= first)
+                break;
+            if ((p == begin || !isWordChar(p[-1])) && (p + name.size() == end || !isWordChar(p[name.size()])))
+            {
+                first = p;
+                found = (int)level;
+                break;
+            }
+            p++;
+        }
+    }
+    return found;
+}
+
+static bool isDigits(const char *p, int n)
+{
+    for (int i = 0; i < n; i++)
+        if (p[i] < '0' || p[i] > '9')
+            return false;
+    return true;
+}
+
+static int toInt(const char *p, int n)
+{
+    int v = 0;
+    for (int i = 0; i < n; i++)
+        v = v * 10 + (p[i] - '0');
+    return v;
+}
+
+// 解析日志行中的时间，不带日期的时间参考相邻日志的时间确定日期
+class LineTime
+{
+public:
+    LineTime(int64_t ref) : _ref(ref), _date(-1), _midnight(0) {}
+
+    // 行内首个 HH:MM:SS 对应的时间戳，没有时返回false
+    bool parse(const char *begin, const char *end, int64_t &t)
+    {
+        for (const char *p = begin; p < end; p++)
+        {
+            p = (const char *)memchr(p, ':', end - p);
+            if (p == nullptr || end - p < 6)
+                return false;
+            if (p - begin < 2)
+                continue;
+            const char *h = p - 2;
+            if (!isDigits(h, 2) || !isDigits(h + 3, 2) || h[5] != ':' || !isDigits(h + 6, 2))
+                continue;
+            int64_t sec = toInt(h, 2) * 3600 + toInt(h + 3, 2) * 60 + toInt(h + 6, 2);
+            // 前置的日期：YYYY-mm-dd 与时间之间有一个分隔符
+            const char *d = h - 11;
+            if (h - begin >= 11 && isDigits(d, 4) && d[4] == '-' && isDigits(d + 5, 2) && d[7] == '-' && isDigits(d + 8, 2))
+            {
+                t = midnight(toInt(d, 4), toInt(d + 5, 2), toInt(d + 8, 2)) + sec;
+            }
+            else
+            {
+                time_t ref = _ref;
+                struct tm tm;
+                localtime_r(&ref, &tm);
+                t = midnight(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday) + sec;
+                if (t > _ref + 43200)
+                    t -= 86400;
+                else if (t < _ref - 43200)
+                    t += 86400;
+            }
+            _ref = t;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    // 当地时间某天零点的时间戳，缓存最近一天
+    int64_t midnight(int year, int mon, int day)
+    {
+        int date = year * 10000 + mon * 100 + day;
+        if (date != _date)
+        {
+            struct tm tm;
+            memset(&tm, 0, sizeof(tm));
+            tm.tm_year = year - 1900;
+            tm.tm_mon = mon - 1;
+            tm.tm_mday = day;
+            tm.tm_isdst = -1;
+            _midnight = mktime(&tm);
+            _date = date;
+        }
+        return _midnight;
+    }
+
+    int64_t _ref; // 最近一条日志的时间
+    int _date;
+    int64_t _midnight;
+};
+
+static bool hasTimeRange(const Query &q)
+{
+    return q._from != INT64_MIN || q._to != INT64_MAX;
+}
+
+// 逐行过滤[begin, end)中的日志，ref 为这部分日志的大致时间，用于确定不带日期的时间属于哪一天
+static void scan(const char *begin, const char *end, const Query &q, int64_t ref, Stats &st)
+{
+    bool keep = false;
+    bool in_range = true;
+    bool by_time = hasTimeRange(q);
+    LineTime lt(ref);
+    const char *line = begin;
+    while (line < end)
+    {
+        const char *eol = (const char *)memchr(line, '\n', end - line);
+        const char *next = eol == nullptr ? end : eol + 1;
+        int level = lineLevel(line, next);
+        int64_t t;
+        if (by_time && lt.parse(line, next, t))
+            in_range = (t >= q._from && t <= q._to);
+        if (level >= 0)
+            keep = (q._levels & (1u << level)) && (q._logger.empty() || findWord(line, next, q._logger));
+        if (keep && in_range)
+        {
+            fwrite(line, 1, next - line, stdout);
+            st._matched++;
+        }
+        line = next;
+    }
+    st._scanned += end - begin;
+}
+
+static bool blockMatch(const IndexBlock &b, const Query &q)
+{
+    if (b._tmax < q._from || b._tmin > q._to)
+        return false;
+    if ((b._levels & q._levels) == 0)
+        return false;
+    if (!q._logger.empty() && (b._loggers & q._logger_bit) == 0)
+        return false;
+    return true;
+}
+
+static bool query(const std::string &path, const Query &q, bool use_index, Stats &st)
+{
+    struct stat sb;
+    if (stat(path.c_str(), &sb) != 0)
+        return false;
+    MappedFile data(path);
+    // 空文件没有可输出的日志
+    if (data.data() == nullptr)
+        return true;
+    const char *base = data.data();
+    st._total += data.size();
+    size_t covered = 0;     // 已处理至日志文件的位置
+    int64_t ref = sb.st_mtime; // 未被索引覆盖的部分参考前一个块的时间，没有时参考文件的修改时间
+    MappedFile index(use_index ? path + LOG_INDEX_SUFFIX : std::string());
+    if (index.data() != nullptr && index.size() >= sizeof(IndexHeader) && memcmp(index.data(), LOG_INDEX_MAGIC, 8) == 0)
+    {
+        size_t count = (index.size() - sizeof(IndexHeader)) / sizeof(IndexBlock);
+        st._blocks += count;
+        const char *ptr = index.data() + sizeof(IndexHeader);
+        for (size_t i = 0; i < count; i++)
+        {
+            IndexBlock b;
+            memcpy(&b, ptr + i * sizeof(IndexBlock), sizeof(b));
+            if (b._offset + b._length > data.size() || b._offset < covered)
+                break; // 索引与日志文件不一致，之后的部分逐行扫描
+            // 索引未覆盖的间隙逐行扫描
+            if (b._offset > covered)
+                scan(base + covered, base + b._offset, q, b._tmin, st);
+            covered = b._offset + b._length;
+            ref = b._tmax;
+            if (blockMatch(b, q) == false)
+                continue;
+            st._selected++;
+            // 整块都在时间范围内且等级全部匹配时不需要逐行判断
+            bool inside = b._tmin >= q._from && b._tmax <= q._to;
+            if (inside && (b._levels & ~q._levels) == 0 && q._logger.empty())
+            {
+                fwrite(base + b._offset, 1, b._length, stdout);
+                st._scanned += b._length;
+                st._matched += b._count;
+            }
+            else
+            {
+                scan(base + b._offset, base + covered, q, b._tmin, st);
+            }
+        }
+    }
+    if (covered < data.size())
+        scan(base + covered, base + data.size(), q, ref, st);
+    return true;
+}
+
+// 解析时间：YYYY-mm-dd HH:MM:SS，HH:MM:SS 或 HH:MM（当天），纯数字为时间戳
+static bool parseTime(const std::string &str, int64_t &t)
+{
+    if (!str.empty() && str.find_first_not_of("0123456789") == std::string::npos)
+    {
+        t = strtoll(str.c_str(), nullptr, 10);
+        return true;
+    }
+    time_t now = time(nullptr);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    tm.tm_sec = 0;
+    const char *end = strptime(str.c_str(), "%Y-%m-%d %H:%M:%S", &tm);
+    if (end == nullptr || *end != '\0')
+    {
+        localtime_r(&now, &tm);
+        tm.tm_sec = 0;
+        end = strptime(str.c_str(), "%H:%M:%S", &tm);
+        if (end == nullptr || *end != '\0')
+            end = strptime(str.c_str(), "%H:%M", &tm);
+    }
+    if (end == nullptr || *end != '\0')
+        return false;
+    tm.tm_isdst = -1;
+    t = mktime(&tm);
+    return true;
+}
+
+static void usage()
+{
+    std::cerr << "用法：logquery [-l 最低等级] [-L 日志器] [-f 起始时间] [-t 结束时间] [-n] [-s] 文件...\n"
+              << "  -l  只输出不低于该等级的日志，如 ERROR\n"
+              << "  -L  只输出指定日志器的日志\n"
+              << "  -f/-t  时间范围（包含两端），格式 YYYY-mm-dd HH:MM:SS，HH:MM:SS，HH:MM 或时间戳\n"
+              << "  -n  不使用索引，逐行扫描全部文件（用于对比）\n"
+              << "  -s  在标准错误输出读取的块数，字节数与耗时\n";
+}
+
+int main(int argc, char *argv[])
+{
+    Query q;
+    q._levels = ~0u;
+    q._logger_bit = 0;
+    q._from = INT64_MIN;
+    q._to = INT64_MAX;
+    bool use_index = true, stats = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++)
+    {
+        LogLevel::value level;
+        if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+        {
+            if (LogLevel::fromString(argv[++i], level) == false)
+                return usage(), 1;
+            q._levels = ~0u << (int)level;
+        }
+        else if (strcmp(argv[i], "-L") == 0 && i + 1 < argc)
+        {
+            q._logger = argv[++i];
+            q._logger_bit = IndexBlock::loggerBit(q._logger);
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            if (parseTime(argv[++i], q._from) == false)
+                return usage(), 1;
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            if (parseTime(argv[++i], q._to) == false)
+                return usage(), 1;
+        }
+        else if (strcmp(argv[i], "-n") == 0)
+            use_index = false;
+        else if (strcmp(argv[i], "-s") == 0)
+            stats = true;
+        else if (argv[i][0] == '-')
+            return usage(), 1;
+        else
+            files.push_back(argv[i]);
+    }
+    if (files.empty())
+        return usage(), 1;
+
+    Stats st = {0, 0, 0, 0, 0};
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &file : files)
+    {
+        if (query(file, q, use_index, st) == false)
+        {
+            std::cerr << "打开文件失败：" << file << "\n";
+            return 1;
+        }
+    }
+    fflush(stdout);
+    if (stats)
+    {
+        std::chrono::duration<double> cost = std::chrono::steady_clock::now() - start;
+        std::cerr << "索引块: " << st._selected << "/" << st._blocks
+                  << ", 读取: " << st._scanned / 1024 << "KB/" << st._total / 1024 << "KB"
+                  << ", 输出条数: " << st._matched
+                  << ", 耗时: " << cost.count() << "s\n";
+    }
+    return 0;
+}